@@ -0,0 +1,68 @@
+#include "asset_loader.hpp"
+
+#include <iostream>
+#include <cassert>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+AssetLoader::~AssetLoader() {
+	cancel();
+}
+
+void AssetLoader::add(std::string const &name, std::function< bool() > const &load, std::function< void() > const &finish) {
+	assert(state == Idle);
+	jobs.emplace_back();
+	jobs.back().name = name;
+	jobs.back().load = load;
+	jobs.back().finish = finish;
+}
+
+void AssetLoader::start() {
+	assert(state == Idle);
+	state = Loading;
+	worker = std::thread([this]() {
+		for (size_t j = 0; j < jobs.size() && !stop; ++j) {
+			if (jobs[j].load && !jobs[j].load()) {
+				load_failed = true;
+				return;
+			}
+			//(release, so the GL thread sees everything the load wrote once it sees the count)
+			loaded.store(j + 1, std::memory_order_release);
+		}
+	});
+}
+
+bool AssetLoader::update() {
+	if (state == Done) return true;
+	if (state != Loading) return false;
+
+	if (finished < loaded.load(std::memory_order_acquire)) {
+		Job &job = jobs[finished];
+		if (job.finish) job.finish();
+		++finished;
+	} else if (load_failed) {
+		worker.join();
+		failed = jobs[finished].name;
+		LOG_ERROR("Failed to load " << failed << ".");
+		state = Failed;
+		return false;
+	}
+
+	if (finished == jobs.size()) {
+		worker.join();
+		state = Done;
+		return true;
+	}
+	return false;
+}
+
+void AssetLoader::cancel() {
+	stop = true;
+	if (worker.joinable()) worker.join();
+	if (state == Loading) state = Idle;
+}
+
+float AssetLoader::progress() const {
+	if (jobs.empty()) return (state == Idle ? 0.0f : 1.0f);
+	return float(loaded.load() + finished) / float(2 * jobs.size());
+}
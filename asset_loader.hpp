@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Loads a list of assets on a worker thread so the GL thread can keep presenting frames meanwhile.
+ * Each job has a 'load' step, run on the worker (file reads, decoding -- no GL calls), and a
+ * 'finish' step, run on the GL thread by update() once its load is done (creating GL objects from
+ * what was loaded). Loads run one after another in the order the jobs were added, and so do
+ * finishes, so a job may rely on everything added before it; update() runs at most one finish per
+ * call, so the GL work is spread over frames as the assets arrive rather than landing all at once.
+ *
+ * All members must be called on the GL thread.
+ */
+
+struct AssetLoader {
+	AssetLoader() = default;
+	~AssetLoader();
+	AssetLoader(AssetLoader const &) = delete;
+	AssetLoader &operator=(AssetLoader const &) = delete;
+
+	//add a job (before start()); 'name' is only for messages, either step may be empty, and 'load'
+	// returns false if the asset couldn't be loaded:
+	void add(std::string const &name, std::function< bool() > const &load, std::function< void() > const &finish);
+
+	//start the worker on the jobs added so far:
+	void start();
+
+	//run the next finish, if its load is done; returns true once every job is finished (and on every call after that):
+	bool update();
+
+	//stop after the load in progress, if any (waiting for it) -- finishes aren't run:
+	void cancel();
+
+	//fraction of the work done, counting a job's load and finish as half each:
+	float progress() const;
+
+	enum State {
+		Idle,
+		Loading,
+		Done,
+		Failed, //a load returned false; 'failed' names the job
+	} state = Idle;
+
+	std::string failed;
+
+private:
+	struct Job {
+		std::string name;
+		std::function< bool() > load;
+		std::function< void() > finish;
+	};
+	std::vector< Job > jobs;
+	std::thread worker;
+	//jobs the worker has loaded (it stops at a failed one); written by the worker only:
+	std::atomic< size_t > loaded{0};
+	std::atomic< bool > load_failed{false};
+	std::atomic< bool > stop{false};
+	//jobs finished on the GL thread:
+	size_t finished = 0;
+};
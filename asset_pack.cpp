@@ -0,0 +1,257 @@
+#include "asset_pack.hpp"
+#include "lz4.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+static const char PACK_MAGIC[8] = {'p','x','p','a','c','k','\0','\0'};
+static const uint32_t PACK_VERSION = 1;
+//the header and every payload start on a page boundary:
+static const size_t PACK_PAGE_SIZE = 4096;
+static const uint32_t PACK_MAX_BUCKET_BITS = 24;
+//an LZ4 block never expands to more than this (so a bigger claimed size means a corrupt entry):
+static uint64_t lz4_max_decompressed_size(uint64_t stored_size) {
+	return stored_size * 255 + 16;
+}
+
+struct PackHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t bucket_bits;
+	uint32_t padding;
+	uint64_t directory_offset; //entries, then (1 << bucket_bits) + 1 bucket starts, then names
+	uint64_t directory_size;
+};
+static_assert(sizeof(PackHeader) <= PACK_PAGE_SIZE, "Pack header fits in its page.");
+
+static uint64_t hash_name(char const *name, size_t length) {
+	return hash_bytes(reinterpret_cast< uint8_t const * >(name), length);
+}
+
+static uint32_t bucket_of(uint64_t hash, uint32_t bucket_bits) {
+	return (bucket_bits ? uint32_t(hash >> (64 - bucket_bits)) : 0);
+}
+
+static size_t round_up(size_t size, size_t to) {
+	return (size + to - 1) / to * to;
+}
+
+//'name' is only for messages:
+static bool read_pack(uint8_t const *bytes, size_t bytes_size, std::string const &name, AssetPack *pack) {
+	PackHeader header;
+	if (bytes_size < PACK_PAGE_SIZE || reinterpret_cast< uintptr_t >(bytes) % 8 != 0) {
+		LOG_ERROR("Asset pack " << name << " is too short to hold a header (or isn't 8-byte aligned).");
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION) {
+		LOG_ERROR(name << " is not a (version " << PACK_VERSION << ") asset pack.");
+		return false;
+	}
+	size_t bucket_count = (size_t(1) << std::min(header.bucket_bits, PACK_MAX_BUCKET_BITS)) + 1;
+	size_t fixed_size = size_t(header.entry_count) * sizeof(PackEntry) + bucket_count * sizeof(uint32_t);
+	if (header.bucket_bits > PACK_MAX_BUCKET_BITS || header.directory_offset % 8 != 0
+	 || header.directory_offset > bytes_size || bytes_size - header.directory_offset < header.directory_size
+	 || header.directory_size < fixed_size) {
+		LOG_ERROR("Asset pack " << name << " has a bad directory.");
+		return false;
+	}
+	PackEntry const *dir_entries = reinterpret_cast< PackEntry const * >(bytes + header.directory_offset);
+	uint32_t const *dir_buckets = reinterpret_cast< uint32_t const * >(dir_entries + header.entry_count);
+	char const *dir_names = reinterpret_cast< char const * >(dir_buckets + bucket_count);
+	size_t names_size = header.directory_size - fixed_size;
+
+	//check everything lookups will rely on, once, here:
+	if (dir_buckets[0] != 0 || dir_buckets[bucket_count - 1] != header.entry_count) {
+		LOG_ERROR("Asset pack " << name << " has a bad bucket index.");
+		return false;
+	}
+	for (size_t b = 0; b + 1 < bucket_count; ++b) {
+		if (dir_buckets[b] > dir_buckets[b + 1]) {
+			LOG_ERROR("Asset pack " << name << " has a bad bucket index.");
+			return false;
+		}
+		for (uint32_t i = dir_buckets[b]; i < dir_buckets[b + 1]; ++i) {
+			PackEntry const &e = dir_entries[i];
+			bool good = bucket_of(e.hash, header.bucket_bits) == b
+				&& (i == 0 || dir_entries[i - 1].hash <= e.hash)
+				&& e.offset % PACK_PAGE_SIZE == 0 && e.offset >= PACK_PAGE_SIZE
+				&& e.offset <= header.directory_offset && header.directory_offset - e.offset >= e.stored_size
+				&& ((e.compression == PackLZ4 && e.size <= lz4_max_decompressed_size(e.stored_size))
+				 || (e.compression == PackRaw && e.stored_size == e.size))
+				&& e.name_offset <= names_size && names_size - e.name_offset >= e.name_length
+				&& hash_name(dir_names + e.name_offset, e.name_length) == e.hash;
+			if (!good) {
+				LOG_ERROR("Asset pack " << name << " has a bad directory entry (" << i << ").");
+				return false;
+			}
+		}
+	}
+
+	pack->data = bytes;
+	pack->size = bytes_size;
+	pack->entries = dir_entries;
+	pack->entry_count = header.entry_count;
+	pack->buckets = dir_buckets;
+	pack->bucket_bits = header.bucket_bits;
+	pack->names = dir_names;
+	return true;
+}
+
+bool AssetPack::open(std::string const &filename) {
+	close();
+	MappedFile mapped;
+	if (!mapped.open(filename)) {
+		return false;
+	}
+	if (!read_pack(mapped.data, mapped.size, "'" + filename + "'", this)) {
+		return false;
+	}
+	//(moving the mapping leaves it where it is, so the pointers stay good)
+	file = std::move(mapped);
+	return true;
+}
+
+bool AssetPack::open(uint8_t const *bytes, size_t bytes_size) {
+	close();
+	return read_pack(bytes, bytes_size, "(in memory)", this);
+}
+
+void AssetPack::close() {
+	data = nullptr;
+	size = 0;
+	entries = nullptr;
+	entry_count = 0;
+	buckets = nullptr;
+	bucket_bits = 0;
+	names = nullptr;
+	file.close();
+}
+
+PackEntry const *AssetPack::find(std::string const &name) const {
+	if (!entries) return nullptr;
+	uint64_t hash = hash_name(name.data(), name.size());
+	uint32_t b = bucket_of(hash, bucket_bits);
+	for (uint32_t i = buckets[b]; i < buckets[b + 1]; ++i) {
+		PackEntry const &e = entries[i];
+		if (e.hash == hash && e.name_length == name.size() && memcmp(names + e.name_offset, name.data(), name.size()) == 0) {
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+bool AssetPack::get(PackEntry const &entry, AssetSpan *span, std::vector< uint8_t > *scratch) const {
+	assert(span);
+	assert(scratch);
+	if (entry.compression == PackRaw) {
+		span->data = data + entry.offset;
+		span->size = size_t(entry.size);
+		return true;
+	}
+	scratch->resize(size_t(entry.size));
+	if (!lz4_decompress(data + entry.offset, size_t(entry.stored_size), scratch->data(), scratch->size())) {
+		LOG_ERROR("Pack entry '" << std::string(names + entry.name_offset, entry.name_length) << "' didn't decompress.");
+		return false;
+	}
+	span->data = scratch->data();
+	span->size = scratch->size();
+	return true;
+}
+
+bool save_asset_pack(std::string const &filename, std::vector< PackInput > const &inputs) {
+	struct Stored {
+		PackInput const *input;
+		uint64_t hash;
+		std::vector< uint8_t > lz4; //empty if stored raw
+	};
+	std::vector< Stored > stored;
+	stored.reserve(inputs.size());
+	for (auto const &input : inputs) {
+		stored.emplace_back();
+		Stored &s = stored.back();
+		s.input = &input;
+		s.hash = hash_name(input.name.data(), input.name.size());
+		if (input.raw) continue;
+		std::vector< uint8_t > lz4(lz4_compress_bound(input.bytes.size()));
+		lz4.resize(lz4_compress(input.bytes.data(), input.bytes.size(), lz4.data()));
+		if (lz4.size() <= input.bytes.size() - input.bytes.size() / 8 && !input.bytes.empty()) {
+			s.lz4 = std::move(lz4);
+		}
+	}
+	std::sort(stored.begin(), stored.end(), [](Stored const &a, Stored const &b) {
+		if (a.hash != b.hash) return a.hash < b.hash;
+		return a.input->name < b.input->name;
+	});
+	for (size_t i = 1; i < stored.size(); ++i) {
+		if (stored[i].input->name == stored[i-1].input->name) {
+			LOG_ERROR("Can't pack two entries named '" << stored[i].input->name << "'.");
+			return false;
+		}
+	}
+
+	PackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.entry_count = uint32_t(stored.size());
+	//about one entry per bucket:
+	while (header.bucket_bits < PACK_MAX_BUCKET_BITS && (size_t(1) << header.bucket_bits) < stored.size()) {
+		++header.bucket_bits;
+	}
+
+	std::vector< PackEntry > entries(stored.size());
+	std::string names;
+	uint64_t offset = PACK_PAGE_SIZE;
+	for (size_t i = 0; i < stored.size(); ++i) {
+		PackEntry &e = entries[i];
+		memset(&e, 0, sizeof(e));
+		e.hash = stored[i].hash;
+		e.offset = offset;
+		e.size = stored[i].input->bytes.size();
+		e.compression = (stored[i].lz4.empty() ? PackRaw : PackLZ4);
+		e.stored_size = (e.compression == PackRaw ? e.size : stored[i].lz4.size());
+		e.name_offset = uint32_t(names.size());
+		e.name_length = uint32_t(stored[i].input->name.size());
+		names += stored[i].input->name;
+		offset += round_up(size_t(e.stored_size), PACK_PAGE_SIZE);
+	}
+	std::vector< uint32_t > buckets((size_t(1) << header.bucket_bits) + 1, 0);
+	for (size_t b = 0, i = 0; b < buckets.size(); ++b) {
+		while (i < entries.size() && bucket_of(entries[i].hash, header.bucket_bits) < b) ++i;
+		buckets[b] = uint32_t(i);
+	}
+	buckets.back() = uint32_t(entries.size());
+	header.directory_offset = offset;
+	header.directory_size = entries.size() * sizeof(PackEntry) + buckets.size() * sizeof(uint32_t) + names.size();
+
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	std::vector< char > page(PACK_PAGE_SIZE, 0);
+	memcpy(&page[0], &header, sizeof(header));
+	file.write(&page[0], page.size());
+	memset(&page[0], 0, sizeof(header));
+	for (size_t i = 0; i < stored.size(); ++i) {
+		size_t bytes = size_t(entries[i].stored_size);
+		char const *payload = reinterpret_cast< char const * >(stored[i].lz4.empty() ? stored[i].input->bytes.data() : stored[i].lz4.data());
+		file.write(payload, bytes);
+		//pad out to the next page:
+		file.write(&page[0], (PACK_PAGE_SIZE - bytes % PACK_PAGE_SIZE) % PACK_PAGE_SIZE);
+	}
+	file.write(reinterpret_cast< char const * >(entries.data()), entries.size() * sizeof(PackEntry));
+	file.write(reinterpret_cast< char const * >(buckets.data()), buckets.size() * sizeof(uint32_t));
+	file.write(names.data(), names.size());
+	if (!file) {
+		LOG_ERROR("Failed to write asset pack '" << filename << "'.");
+		file.close();
+		std::remove(filename.c_str());
+		return false;
+	}
+	return true;
+}
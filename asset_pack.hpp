@@ -0,0 +1,74 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Single-file asset pack (written by build_pack).
+ * A pack is a page-sized header, then each entry's payload starting on a page boundary, then the directory:
+ * entries sorted by (64-bit FNV-1a) name hash, a bucket index over the hash's top bits, and the names.
+ * Payloads are stored raw or as one LZ4 block (see lz4.hpp) -- whichever build_pack found worth it, except that
+ * inputs marked raw (files laid out to be used straight out of a mapping, like .mips) are always stored raw.
+ * Opening a pack maps it (or takes bytes already in memory) and checks the directory once; after that,
+ * finding an entry is a bucket lookup and raw payloads are handed out straight from the mapping.
+ */
+
+enum PackCompression : uint32_t {
+	PackRaw = 0,
+	PackLZ4 = 1,
+};
+
+struct PackEntry {
+	uint64_t hash; //of the name
+	uint64_t offset; //of the payload, from the start of the pack
+	uint64_t stored_size; //payload size in the pack
+	uint64_t size; //size once decompressed
+	uint32_t compression; //PackCompression
+	uint32_t name_offset; //into the directory's name block
+	uint32_t name_length;
+	uint32_t padding;
+};
+static_assert(sizeof(PackEntry) == 48, "PackEntry is packed.");
+
+//an asset's bytes, which stay valid as long as wherever they came from does:
+struct AssetSpan {
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+};
+
+struct AssetPack {
+	//map 'filename' as the pack:
+	bool open(std::string const &filename);
+	//use a pack that's already in memory (and stays there as long as this AssetPack is used):
+	bool open(uint8_t const *bytes, size_t size);
+	void close();
+
+	//nullptr if the pack has no such entry:
+	PackEntry const *find(std::string const &name) const;
+	//raw entries point into the pack; LZ4 entries are decompressed into 'scratch', and point there:
+	bool get(PackEntry const &entry, AssetSpan *span, std::vector< uint8_t > *scratch) const;
+
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+	PackEntry const *entries = nullptr;
+	uint32_t entry_count = 0;
+	//entries with hash >> (64 - bucket_bits) == b are entries[buckets[b]] to entries[buckets[b+1]-1]:
+	uint32_t const *buckets = nullptr;
+	uint32_t bucket_bits = 0;
+	char const *names = nullptr;
+	MappedFile file;
+};
+
+struct PackInput {
+	std::string name;
+	std::vector< uint8_t > bytes;
+	//never compress (the payload still starts on a page boundary, so it can be used in place):
+	bool raw = false;
+};
+
+//entries not marked raw are stored LZ4-compressed when that saves at least an eighth of their size:
+bool save_asset_pack(std::string const &filename, std::vector< PackInput > const &inputs);
@@ -0,0 +1,108 @@
+#include "load_save_png.hpp"
+#include "load_png_batch.hpp"
+#include "save_png_parallel.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Compares loading N atlases one after another with loading them through PngBatch,
+// then encoding one atlas with save_png and with save_png_parallel.
+//usage: bench_png [atlas count] [atlas size] [threads]
+
+//atlas-like test image: flat-colored tiles with some noise, so it compresses about like real art:
+static std::vector< uint32_t > make_atlas(unsigned int size, uint32_t seed) {
+	std::vector< uint32_t > data(size_t(size) * size);
+	uint32_t state = seed * 2654435761U + 1;
+	auto rand32 = [&state]() {
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		return state;
+	};
+	const unsigned int tile = 32;
+	std::vector< uint32_t > tile_colors(((size + tile - 1) / tile) * ((size + tile - 1) / tile));
+	for (auto &c : tile_colors) c = rand32() | 0xff000000;
+	for (unsigned int y = 0; y < size; ++y) {
+		for (unsigned int x = 0; x < size; ++x) {
+			uint32_t c = tile_colors[(y / tile) * ((size + tile - 1) / tile) + (x / tile)];
+			if ((rand32() & 15) == 0) c ^= (rand32() & 0x000f0f0f);
+			data[size_t(y) * size + x] = c;
+		}
+	}
+	return data;
+}
+
+int main(int argc, char **argv) {
+	unsigned int count = (argc > 1 ? std::atoi(argv[1]) : 8);
+	unsigned int size = (argc > 2 ? std::atoi(argv[2]) : 2048);
+	unsigned int threads = (argc > 3 ? std::atoi(argv[3]) : 0);
+	if (count == 0 || size == 0) {
+		std::cerr << "usage: " << argv[0] << " [atlas count] [atlas size] [threads]" << std::endl;
+		return 1;
+	}
+
+	std::vector< std::string > filenames;
+	for (unsigned int i = 0; i < count; ++i) {
+		filenames.emplace_back("bench_atlas_" + std::to_string(i) + ".png");
+		std::vector< uint32_t > data = make_atlas(size, i);
+		save_png(filenames.back(), size, size, data.data(), UpperLeftOrigin);
+	}
+	double megabytes = double(count) * size * size * 4 / (1024.0 * 1024.0);
+	std::cout << count << " atlases of " << size << "x" << size << " (" << megabytes << " MB decoded)" << std::endl;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	bool ok = true;
+
+	{ //serial:
+		auto before = Clock::now();
+		for (auto const &filename : filenames) {
+			PngImage image;
+			ok = load_png(filename, &image.width, &image.height, &image.data, UpperLeftOrigin) && ok;
+		}
+		float elapsed = std::chrono::duration< float >(Clock::now() - before).count();
+		std::cout << "  serial:   " << elapsed * 1000.0f << " ms, " << megabytes / elapsed << " MB/s" << std::endl;
+	}
+
+	{ //parallel:
+		auto before = Clock::now();
+		PngBatch batch(filenames, UpperLeftOrigin, PngBatch::Callback(), threads);
+		for (auto &result : batch.results) {
+			ok = result.get() && ok;
+		}
+		float elapsed = std::chrono::duration< float >(Clock::now() - before).count();
+		std::cout << "  parallel: " << elapsed * 1000.0f << " ms, " << megabytes / elapsed << " MB/s"
+			<< " (" << (threads ? threads : std::thread::hardware_concurrency()) << " threads)" << std::endl;
+	}
+
+	{ //encode:
+		std::vector< uint32_t > data = make_atlas(size, 0);
+		double atlas_megabytes = double(size) * size * 4 / (1024.0 * 1024.0);
+
+		auto before = Clock::now();
+		std::ostringstream serial;
+		save_png(serial, size, size, data.data(), UpperLeftOrigin);
+		float elapsed = std::chrono::duration< float >(Clock::now() - before).count();
+		std::cout << "  save_png:          " << elapsed * 1000.0f << " ms, " << atlas_megabytes / elapsed << " MB/s, "
+			<< serial.str().size() << " bytes" << std::endl;
+
+		before = Clock::now();
+		std::ostringstream parallel;
+		ok = save_png_parallel(parallel, size, size, data.data(), UpperLeftOrigin, threads) && ok;
+		elapsed = std::chrono::duration< float >(Clock::now() - before).count();
+		std::cout << "  save_png_parallel: " << elapsed * 1000.0f << " ms, " << atlas_megabytes / elapsed << " MB/s, "
+			<< parallel.str().size() << " bytes" << std::endl;
+	}
+
+	for (auto const &filename : filenames) {
+		std::remove(filename.c_str());
+	}
+
+	if (!ok) {
+		std::cerr << "Some atlases failed to load or save." << std::endl;
+		return 1;
+	}
+	return 0;
+}
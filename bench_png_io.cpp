@@ -0,0 +1,248 @@
+#include "load_save_png.hpp"
+
+#include <png.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+//Times load_png and save_png on generated images of several sizes and PNG color types, in both origins.
+//Decoding reads from memory so the numbers are about the codec, not the disk.
+//usage: bench_png_io [max size] [seconds per case]
+
+//---- allocation counting ----
+//(counts operator new only -- libpng's own malloc calls aren't seen, but every vector/stream buffer is)
+
+static std::atomic< size_t > allocations(0);
+static std::atomic< size_t > allocated_bytes(0);
+
+void *operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+//peak resident set size of the process so far, in megabytes:
+static double peak_rss_megabytes() {
+	#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+	#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+	#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0); //bytes
+	#else
+	return usage.ru_maxrss / 1024.0; //kilobytes
+	#endif
+	#endif
+}
+
+//---- test images ----
+
+struct ColorType {
+	char const *name;
+	int png_color_type;
+	int bit_depth;
+};
+
+static const unsigned int SIZES[] = { 64, 256, 1024, 4096, 8192 };
+
+static const ColorType COLOR_TYPES[] = {
+	{"palette", PNG_COLOR_TYPE_PALETTE, 8},
+	{"gray", PNG_COLOR_TYPE_GRAY, 8},
+	{"rgb", PNG_COLOR_TYPE_RGB, 8},
+	{"rgba", PNG_COLOR_TYPE_RGBA, 8},
+	{"rgba16", PNG_COLOR_TYPE_RGBA, 16},
+};
+
+static void vector_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
+	std::vector< uint8_t > *to = reinterpret_cast< std::vector< uint8_t > * >(png_get_io_ptr(png_ptr));
+	to->insert(to->end(), data, data + length);
+}
+
+static void vector_flush_data(png_structp png_ptr) {
+}
+
+//atlas-like content (flat 32x32 tiles with sparse noise) written directly with libpng in the given
+// color type, since save_png only ever writes 8-bit RGBA:
+static std::vector< uint8_t > make_png(unsigned int size, ColorType const &type, uint32_t seed) {
+	uint32_t state = seed * 2654435761U + 1;
+	auto rand32 = [&state]() {
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		return state;
+	};
+	png_color palette[256];
+	for (auto &c : palette) {
+		uint32_t r = rand32();
+		c.red = r & 0xff; c.green = (r >> 8) & 0xff; c.blue = (r >> 16) & 0xff;
+	}
+	const unsigned int tile = 32;
+	const unsigned int tiles = (size + tile - 1) / tile;
+	std::vector< uint8_t > tile_index(size_t(tiles) * tiles);
+	for (auto &i : tile_index) i = uint8_t(rand32());
+
+	std::vector< uint8_t > out;
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png_create_info_struct(png);
+	if (setjmp(png_jmpbuf(png))) {
+		std::cerr << "  png internal error while making test image." << std::endl;
+		png_destroy_write_struct(&png, &info);
+		std::exit(1);
+	}
+	png_set_write_fn(png, &out, vector_write_data, vector_flush_data);
+	png_set_IHDR(png, info, size, size, type.bit_depth, type.png_color_type,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	if (type.png_color_type == PNG_COLOR_TYPE_PALETTE) {
+		png_set_PLTE(png, info, palette, 256);
+	}
+	png_write_info(png, info);
+
+	std::vector< uint8_t > row(png_get_rowbytes(png, info));
+	for (unsigned int y = 0; y < size; ++y) {
+		uint8_t *at = row.data();
+		for (unsigned int x = 0; x < size; ++x) {
+			uint8_t index = tile_index[(y / tile) * tiles + (x / tile)];
+			if ((rand32() & 15) == 0) index ^= (rand32() & 0x3);
+			png_color const &c = palette[index];
+			uint8_t alpha = uint8_t(0xff - (index & 0x3f));
+			if (type.png_color_type == PNG_COLOR_TYPE_PALETTE) {
+				*(at++) = index;
+			} else if (type.png_color_type == PNG_COLOR_TYPE_GRAY) {
+				*(at++) = uint8_t((c.red * 77 + c.green * 150 + c.blue * 29) >> 8);
+			} else {
+				uint8_t channels[4] = { c.red, c.green, c.blue, alpha };
+				unsigned int count = (type.png_color_type == PNG_COLOR_TYPE_RGBA ? 4 : 3);
+				for (unsigned int i = 0; i < count; ++i) {
+					*(at++) = channels[i];
+					//16-bit samples are big-endian; give the low byte a little noise:
+					if (type.bit_depth == 16) *(at++) = uint8_t(rand32() & 0x0f);
+				}
+			}
+		}
+		png_write_row(png, row.data());
+	}
+	png_write_end(png, NULL);
+	png_destroy_write_struct(&png, &info);
+	return out;
+}
+
+//---- timing ----
+
+struct Result {
+	double milliseconds = 0.0; //mean per iteration
+	double megabytes_per_second = 0.0; //decoded (RGBA8) bytes
+	double allocations = 0.0; //per iteration
+	double allocated_megabytes = 0.0; //per iteration
+	bool ok = true;
+};
+
+//run 'fn' until at least 'seconds' have passed (and at least once), after one untimed warm-up run
+// so that buffers being grown for the first time don't count:
+template< typename FN >
+static Result measure(double decoded_megabytes, double seconds, FN const &fn) {
+	typedef std::chrono::high_resolution_clock Clock;
+	Result result;
+	result.ok = fn();
+	size_t iterations = 0;
+	size_t allocations_before = allocations.load();
+	size_t bytes_before = allocated_bytes.load();
+	auto before = Clock::now();
+	double elapsed = 0.0;
+	do {
+		result.ok = fn() && result.ok;
+		++iterations;
+		elapsed = std::chrono::duration< double >(Clock::now() - before).count();
+	} while (elapsed < seconds);
+	result.milliseconds = elapsed * 1000.0 / iterations;
+	result.megabytes_per_second = decoded_megabytes * iterations / elapsed;
+	result.allocations = double(allocations.load() - allocations_before) / iterations;
+	result.allocated_megabytes = double(allocated_bytes.load() - bytes_before) / iterations / (1024.0 * 1024.0);
+	return result;
+}
+
+static void report(std::string const &what, Result const &result) {
+	std::cout << "  " << std::left << std::setw(28) << what << std::right << std::fixed
+		<< std::setw(10) << std::setprecision(3) << result.milliseconds << " ms"
+		<< std::setw(10) << std::setprecision(1) << result.megabytes_per_second << " MB/s"
+		<< std::setw(9) << std::setprecision(1) << result.allocations << " allocs"
+		<< std::setw(9) << std::setprecision(1) << result.allocated_megabytes << " MB alloc'd"
+		<< std::setw(9) << std::setprecision(1) << peak_rss_megabytes() << " MB peak RSS"
+		<< (result.ok ? "" : "  FAILED") << std::endl;
+}
+
+int main(int argc, char **argv) {
+	unsigned int max_size = (argc > 1 ? std::atoi(argv[1]) : 8192);
+	double seconds = (argc > 2 ? std::atof(argv[2]) : 0.25);
+	if (max_size < 64 || seconds < 0.0) {
+		std::cerr << "usage: " << argv[0] << " [max size >= 64] [seconds per case]" << std::endl;
+		return 1;
+	}
+
+	bool ok = true;
+	for (unsigned int dim : SIZES) {
+		if (dim > max_size) break;
+		double decoded_megabytes = double(dim) * dim * 4 / (1024.0 * 1024.0);
+		std::cout << dim << "x" << dim << " (" << decoded_megabytes << " MB as RGBA8):" << std::endl;
+		for (ColorType const &type : COLOR_TYPES) {
+			std::vector< uint8_t > file = make_png(dim, type, dim);
+			std::vector< uint32_t > pixels;
+			for (OriginLocation origin : { UpperLeftOrigin, LowerLeftOrigin }) {
+				std::string name = std::string(type.name) + (origin == UpperLeftOrigin ? " upper" : " lower");
+
+				//decode into a vector that is reused, as a loader in steady state would:
+				Result decode = measure(decoded_megabytes, seconds, [&]() {
+					unsigned int w = 0, h = 0;
+					return load_png(file.data(), file.size(), &w, &h, &pixels, origin) && w == dim && h == dim;
+				});
+				report(name + " decode", decode);
+				ok = decode.ok && ok;
+
+				Result encode = measure(decoded_megabytes, seconds, [&]() {
+					std::ostringstream out;
+					save_png(out, dim, dim, pixels.data(), origin);
+					return bool(out);
+				});
+				report(name + " encode", encode);
+				ok = encode.ok && ok;
+			}
+		}
+	}
+
+	if (!ok) {
+		std::cerr << "Some cases failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,273 @@
+#include "block_compress.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+size_t block_compressed_size(unsigned int width, unsigned int height, BlockFormat format) {
+	size_t blocks = size_t((width + 3) / 4) * ((height + 3) / 4);
+	return blocks * (format == BlockBC1 ? 8 : 16);
+}
+
+BlockFormat choose_block_format(unsigned int width, unsigned int height, uint32_t const *pixels) {
+	uint8_t const *px = reinterpret_cast< uint8_t const * >(pixels);
+	for (size_t i = 0; i < size_t(width) * height; ++i) {
+		uint8_t a = px[i * 4 + 3];
+		if (a != 0 && a != 0xff) return BlockBC3;
+	}
+	return BlockBC1;
+}
+
+//the 16 texels of one block, as RGBA bytes:
+struct Block {
+	uint8_t px[16][4];
+};
+
+static void load_block(unsigned int width, unsigned int height, uint32_t const *pixels, unsigned int bx, unsigned int by, Block *block) {
+	for (unsigned int y = 0; y < 4; ++y) {
+		unsigned int sy = std::min(by * 4 + y, height - 1);
+		for (unsigned int x = 0; x < 4; ++x) {
+			unsigned int sx = std::min(bx * 4 + x, width - 1);
+			memcpy(block->px[y * 4 + x], &pixels[size_t(sy) * width + sx], 4);
+		}
+	}
+}
+
+//per-channel min and max over the block (alpha included):
+static void block_bounds(Block const &block, uint8_t min[4], uint8_t max[4]) {
+	#ifdef BLOCK_COMPRESS_SSE2
+	__m128i lo = _mm_loadu_si128(reinterpret_cast< __m128i const * >(block.px[0]));
+	__m128i hi = lo;
+	for (unsigned int i = 4; i < 16; i += 4) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast< __m128i const * >(block.px[i]));
+		lo = _mm_min_epu8(lo, v);
+		hi = _mm_max_epu8(hi, v);
+	}
+	//fold the four texels in each register down to one:
+	lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+	hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+	lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+	hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+	uint32_t lo32 = uint32_t(_mm_cvtsi128_si32(lo));
+	uint32_t hi32 = uint32_t(_mm_cvtsi128_si32(hi));
+	memcpy(min, &lo32, 4);
+	memcpy(max, &hi32, 4);
+	#else
+	for (unsigned int c = 0; c < 4; ++c) {
+		min[c] = max[c] = block.px[0][c];
+	}
+	for (unsigned int i = 1; i < 16; ++i) {
+		for (unsigned int c = 0; c < 4; ++c) {
+			min[c] = std::min(min[c], block.px[i][c]);
+			max[c] = std::max(max[c], block.px[i][c]);
+		}
+	}
+	#endif
+}
+
+static uint16_t to_565(uint8_t const c[3]) {
+	return uint16_t(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+static void from_565(uint16_t v, int out[3]) {
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 2) | (g >> 4);
+	out[2] = (b << 3) | (b >> 2);
+}
+
+//palette and best indices for a pair of endpoints; returns the squared error over the visible texels.
+//(four-color mode when c0 > c1, else three-color mode, whose index 3 is transparent black)
+static int pick_indices(Block const &block, bool transparent, uint16_t c0, uint16_t c1, uint32_t *indices_out) {
+	int palette[4][3];
+	from_565(c0, palette[0]);
+	from_565(c1, palette[1]);
+	unsigned int colors = 4;
+	if (c0 <= c1) {
+		colors = 3;
+		for (unsigned int c = 0; c < 3; ++c) palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+	} else {
+		for (unsigned int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+	uint32_t indices = 0;
+	int error = 0;
+	for (unsigned int i = 0; i < 16; ++i) {
+		uint32_t best = 0;
+		if (transparent && block.px[i][3] == 0) {
+			best = 3;
+		} else {
+			int best_dist = 0x7fffffff;
+			for (uint32_t p = 0; p < colors; ++p) {
+				int dr = block.px[i][0] - palette[p][0];
+				int dg = block.px[i][1] - palette[p][1];
+				int db = block.px[i][2] - palette[p][2];
+				int dist = dr * dr + dg * dg + db * db;
+				if (dist < best_dist) {
+					best_dist = dist;
+					best = p;
+				}
+			}
+			error += best_dist;
+		}
+		indices |= best << (2 * i);
+	}
+	*indices_out = indices;
+	return error;
+}
+
+//least-squares endpoints for the given indices; returns false if they don't pin the endpoints down:
+static bool refit_endpoints(Block const &block, bool transparent, bool four_colors, uint32_t indices, uint8_t c0[3], uint8_t c1[3]) {
+	//weight of endpoint 0 for each index:
+	const float weights4[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	const float weights3[3] = { 1.0f, 0.0f, 0.5f };
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+	for (unsigned int i = 0; i < 16; ++i) {
+		uint32_t index = (indices >> (2 * i)) & 3;
+		if (transparent && block.px[i][3] == 0) continue;
+		float a = (four_colors ? weights4[index] : weights3[index]);
+		float b = 1.0f - a;
+		aa += a * a; ab += a * b; bb += b * b;
+		for (unsigned int c = 0; c < 3; ++c) {
+			ax[c] += a * block.px[i][c];
+			bx[c] += b * block.px[i][c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f) return false;
+	for (unsigned int c = 0; c < 3; ++c) {
+		float v0 = (bb * ax[c] - ab * bx[c]) / det;
+		float v1 = (aa * bx[c] - ab * ax[c]) / det;
+		c0[c] = uint8_t(std::min(255.0f, std::max(0.0f, v0 + 0.5f)));
+		c1[c] = uint8_t(std::min(255.0f, std::max(0.0f, v1 + 0.5f)));
+	}
+	return true;
+}
+
+//order endpoints for the mode: four-color needs color0 > color1, three-color color0 <= color1:
+static void order_endpoints(bool transparent, uint16_t *c0, uint16_t *c1) {
+	if (transparent ? (*c0 > *c1) : (*c0 < *c1)) std::swap(*c0, *c1);
+}
+
+//write the 8-byte color part of a block; with 'transparent', texels with alpha 0 use BC1's
+// three-color mode and its transparent index:
+static void compress_color(Block const &block, bool transparent, uint8_t *out) {
+	//endpoints start as the corners of the bounding box of the (visible) texels:
+	uint8_t min[4] = {255, 255, 255, 255}, max[4] = {0, 0, 0, 0};
+	bool any_visible = false;
+	if (transparent) {
+		for (unsigned int i = 0; i < 16; ++i) {
+			if (block.px[i][3] == 0) continue;
+			any_visible = true;
+			for (unsigned int c = 0; c < 3; ++c) {
+				min[c] = std::min(min[c], block.px[i][c]);
+				max[c] = std::max(max[c], block.px[i][c]);
+			}
+		}
+	} else {
+		block_bounds(block, min, max);
+		any_visible = true;
+	}
+	if (!any_visible) {
+		//all transparent: three-color mode (color0 <= color1) with every index 3:
+		memset(out, 0, 4);
+		memset(out + 4, 0xff, 4);
+		return;
+	}
+	//...picking the diagonal of the box the colors actually run along (red and blue against green):
+	int center[3];
+	for (unsigned int c = 0; c < 3; ++c) center[c] = (min[c] + max[c]) / 2;
+	int cov_rg = 0, cov_bg = 0;
+	for (unsigned int i = 0; i < 16; ++i) {
+		if (transparent && block.px[i][3] == 0) continue;
+		int g = block.px[i][1] - center[1];
+		cov_rg += (block.px[i][0] - center[0]) * g;
+		cov_bg += (block.px[i][2] - center[2]) * g;
+	}
+	if (cov_rg < 0) std::swap(min[0], max[0]);
+	if (cov_bg < 0) std::swap(min[2], max[2]);
+	//...and inset by 1/16 of its size, which cuts the error at the extremes a little:
+	for (unsigned int c = 0; c < 3; ++c) {
+		int inset = (int(max[c]) - int(min[c])) / 16;
+		min[c] = uint8_t(min[c] + inset);
+		max[c] = uint8_t(max[c] - inset);
+	}
+	uint16_t c0 = to_565(max), c1 = to_565(min);
+	order_endpoints(transparent, &c0, &c1);
+	uint32_t indices = 0;
+	int error = pick_indices(block, transparent, c0, c1, &indices);
+
+	//one round of least-squares refinement given those indices, kept if it helps:
+	uint8_t r0[3], r1[3];
+	if (error > 0 && refit_endpoints(block, transparent, c0 > c1, indices, r0, r1)) {
+		uint16_t n0 = to_565(r0), n1 = to_565(r1);
+		order_endpoints(transparent, &n0, &n1);
+		uint32_t n_indices = 0;
+		int n_error = pick_indices(block, transparent, n0, n1, &n_indices);
+		if (n_error < error) {
+			c0 = n0; c1 = n1; indices = n_indices;
+		}
+	}
+
+	out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+	out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+	out[4] = uint8_t(indices); out[5] = uint8_t(indices >> 8);
+	out[6] = uint8_t(indices >> 16); out[7] = uint8_t(indices >> 24);
+}
+
+//write the 8-byte BC3 alpha part of a block, using the eight-value mode (alpha0 > alpha1):
+static void compress_alpha(Block const &block, uint8_t *out) {
+	uint8_t min[4], max[4];
+	block_bounds(block, min, max);
+	uint8_t a0 = max[3], a1 = min[3];
+	out[0] = a0;
+	out[1] = a1;
+	uint64_t indices = 0;
+	if (a0 != a1) {
+		int range = a0 - a1;
+		for (unsigned int i = 0; i < 16; ++i) {
+			//t = weight of alpha0, in sevenths; index 0 is alpha0, 1 is alpha1, 2..7 step from alpha0 toward alpha1:
+			int t = ((block.px[i][3] - a1) * 7 + range / 2) / range;
+			uint64_t index = (t == 7 ? 0 : (t == 0 ? 1 : uint64_t(8 - t)));
+			indices |= index << (3 * i);
+		}
+	}
+	for (unsigned int b = 0; b < 6; ++b) {
+		out[2 + b] = uint8_t(indices >> (8 * b));
+	}
+}
+
+void block_compress(unsigned int width, unsigned int height, uint32_t const *pixels, BlockFormat format, uint8_t *out) {
+	Block block;
+	for (unsigned int by = 0; by < (height + 3) / 4; ++by) {
+		for (unsigned int bx = 0; bx < (width + 3) / 4; ++bx) {
+			load_block(width, height, pixels, bx, by, &block);
+			if (format == BlockBC1) {
+				bool transparent = false;
+				for (unsigned int i = 0; i < 16; ++i) {
+					if (block.px[i][3] < 128) transparent = true;
+				}
+				//(BC1 alpha is all-or-nothing, so any alpha below half rounds to transparent)
+				if (transparent) {
+					for (unsigned int i = 0; i < 16; ++i) {
+						if (block.px[i][3] < 128) block.px[i][3] = 0;
+					}
+				}
+				compress_color(block, transparent, out);
+				out += 8;
+			} else {
+				compress_alpha(block, out);
+				compress_color(block, false, out + 8);
+				out += 16;
+			}
+		}
+	}
+}
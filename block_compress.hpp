@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * CPU encoders for the S3TC block formats (4x4 texel blocks):
+ *  BC1 (DXT1): 8 bytes per block, RGB plus 1-bit alpha -- transparent texels decode as (0,0,0,0).
+ *  BC3 (DXT5): 16 bytes per block, RGB plus interpolated 8-bit alpha.
+ * Input is RGBA8 pixels, tightly packed, rows in whatever order they'll be uploaded in;
+ * sizes needn't be multiples of four (edge blocks repeat their last row/column).
+ * Endpoints come from the (SSE2 where available) bounding box of each block, inset slightly, so
+ * this is quick enough to run at load time; quality is a little below an exhaustive encoder.
+ */
+
+enum BlockFormat {
+	BlockBC1,
+	BlockBC3,
+};
+
+//bytes needed for a width x height image:
+size_t block_compressed_size(unsigned int width, unsigned int height, BlockFormat format);
+
+//BC1 holds the image exactly as far as alpha goes if every alpha is 0 or 255 (and, with premultiplied
+// alpha, BC1's transparent black is exactly right); anything else needs BC3:
+BlockFormat choose_block_format(unsigned int width, unsigned int height, uint32_t const *pixels);
+
+//'out' must hold block_compressed_size(width, height, format) bytes:
+void block_compress(unsigned int width, unsigned int height, uint32_t const *pixels, BlockFormat format, uint8_t *out);
@@ -0,0 +1,202 @@
+#include "mip_texture.hpp"
+#include "load_save_png.hpp"
+#include "premultiply_alpha.hpp"
+#include "sprite_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BUILD_MIPS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+//Builds a mip texture (see mip_texture.hpp) from a PNG atlas.
+//usage: build_mips <out.mips> <in.png> [cell size | in.sprites]
+//(output first, so it can be run by jam's GenFile rule)
+//Given the sprite table pack_atlas wrote with the atlas, the cell size is the table's alignment.
+//
+//The atlas is treated as a grid of cell_size x cell_size cells, each holding (part of) one sprite.
+//Levels come from a 2x2 box filter, which at these sizes never reads across a cell edge, and the
+// chain stops once a cell is a single texel -- so no level ever mixes texels of two sprites.
+//Filtering is gamma-correct (done on linear, alpha-weighted color) and each cell's alpha is
+// rescaled per level to keep the fraction of texels with alpha >= 0.5 that the cell has at level 0,
+// so thin or dotted sprite edges don't fade out as the sprite shrinks.
+
+static float srgb_to_linear(float c) {
+	return (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+}
+
+static float linear_to_srgb(float c) {
+	return (c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f);
+}
+
+//level pixels as linear, premultiplied float RGBA:
+typedef std::vector< float > LinearLevel;
+
+static LinearLevel to_linear(std::vector< uint32_t > const &pixels) {
+	float lut[256];
+	for (unsigned int i = 0; i < 256; ++i) lut[i] = srgb_to_linear(i / 255.0f);
+	LinearLevel linear(pixels.size() * 4);
+	uint8_t const *px = reinterpret_cast< uint8_t const * >(pixels.data());
+	for (size_t i = 0; i < pixels.size() * 4; i += 4) {
+		float a = px[i+3] / 255.0f;
+		linear[i+0] = lut[px[i+0]] * a;
+		linear[i+1] = lut[px[i+1]] * a;
+		linear[i+2] = lut[px[i+2]] * a;
+		linear[i+3] = a;
+	}
+	return linear;
+}
+
+//average each 2x2 block of 'from' (width x height) into one texel:
+static LinearLevel downsample(LinearLevel const &from, unsigned int width, unsigned int height) {
+	unsigned int w = width / 2, h = height / 2;
+	LinearLevel to(size_t(w) * h * 4);
+	for (unsigned int y = 0; y < h; ++y) {
+		float const *row0 = &from[size_t(2 * y) * width * 4];
+		float const *row1 = row0 + size_t(width) * 4;
+		float *out = &to[size_t(y) * w * 4];
+		#ifdef BUILD_MIPS_SSE
+		//one texel is exactly one register:
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (unsigned int x = 0; x < w; ++x, row0 += 8, row1 += 8, out += 4) {
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0), _mm_loadu_ps(row0 + 4)),
+			                        _mm_add_ps(_mm_loadu_ps(row1), _mm_loadu_ps(row1 + 4)));
+			_mm_storeu_ps(out, _mm_mul_ps(sum, quarter));
+		}
+		#else
+		for (unsigned int x = 0; x < w; ++x, row0 += 8, row1 += 8, out += 4) {
+			for (unsigned int c = 0; c < 4; ++c) {
+				out[c] = 0.25f * (row0[c] + row0[4 + c] + row1[c] + row1[4 + c]);
+			}
+		}
+		#endif
+	}
+	return to;
+}
+
+//fraction of a cell's texels with alpha * scale >= 0.5:
+static float coverage(LinearLevel const &level, unsigned int width, unsigned int x0, unsigned int y0, unsigned int size, float scale) {
+	unsigned int count = 0;
+	for (unsigned int y = y0; y < y0 + size; ++y) {
+		for (unsigned int x = x0; x < x0 + size; ++x) {
+			if (level[(size_t(y) * width + x) * 4 + 3] * scale >= 0.5f) ++count;
+		}
+	}
+	return float(count) / float(size * size);
+}
+
+//quantize a linear level back to 8-bit sRGB, straight alpha, scaling alpha by alpha_scale[cell]:
+static std::vector< uint32_t > to_srgb(LinearLevel const &level, unsigned int width, unsigned int height, unsigned int cell, std::vector< float > const &alpha_scale) {
+	std::vector< uint32_t > pixels(size_t(width) * height);
+	uint8_t *px = reinterpret_cast< uint8_t * >(pixels.data());
+	unsigned int cells_x = width / cell;
+	for (unsigned int y = 0; y < height; ++y) {
+		for (unsigned int x = 0; x < width; ++x) {
+			size_t i = size_t(y) * width + x;
+			float const *t = &level[i * 4];
+			float a = std::min(1.0f, t[3] * alpha_scale[(y / cell) * cells_x + (x / cell)]);
+			for (unsigned int c = 0; c < 3; ++c) {
+				float straight = (t[3] > 0.0f ? std::min(1.0f, t[c] / t[3]) : 0.0f);
+				px[i * 4 + c] = uint8_t(std::lround(linear_to_srgb(straight) * 255.0f));
+			}
+			px[i * 4 + 3] = uint8_t(std::lround(a * 255.0f));
+		}
+	}
+	return pixels;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3 || argc > 4) {
+		std::cerr << "usage: " << argv[0] << " <out.mips> <in.png> [cell size | in.sprites]" << std::endl;
+		return 1;
+	}
+	std::string out_filename = argv[1];
+	std::string in_filename = argv[2];
+	unsigned int cell = 32;
+	SpriteTable table;
+	if (argc > 3) {
+		std::string arg = argv[3];
+		if (arg.size() > 8 && arg.substr(arg.size() - 8) == ".sprites") {
+			if (!load_sprite_table(arg, &table)) {
+				return 1;
+			}
+			cell = table.align;
+		} else {
+			cell = std::atoi(argv[3]);
+		}
+	}
+	if (cell == 0 || (cell & (cell - 1)) != 0) {
+		std::cerr << "Cell size (" << cell << ") must be a power of two." << std::endl;
+		return 1;
+	}
+
+	//stored the way the game uploads it: bottom row first, premultiplied:
+	const OriginLocation origin = LowerLeftOrigin;
+	const AlphaMode alpha = PremultipliedAlpha;
+
+	unsigned int width = 0, height = 0;
+	std::vector< uint32_t > base;
+	if (!load_png(in_filename, &width, &height, &base, origin)) {
+		std::cerr << "Failed to load '" << in_filename << "'." << std::endl;
+		return 1;
+	}
+	if (width % cell != 0 || height % cell != 0) {
+		std::cerr << "'" << in_filename << "' is " << width << "x" << height << ", which isn't a whole number of " << cell << "x" << cell << " cells." << std::endl;
+		return 1;
+	}
+	if (table.width != 0 && (table.width != width || table.height != height)) {
+		std::cerr << "'" << in_filename << "' is " << width << "x" << height << ", but its sprite table is for a " << table.width << "x" << table.height << " atlas." << std::endl;
+		return 1;
+	}
+	unsigned int cells_x = width / cell, cells_y = height / cell;
+
+	std::vector< std::vector< uint32_t > > levels;
+	levels.emplace_back(base);
+
+	LinearLevel linear = to_linear(base);
+	//target coverage per cell, from level 0:
+	std::vector< float > target(size_t(cells_x) * cells_y);
+	for (unsigned int cy = 0; cy < cells_y; ++cy) {
+		for (unsigned int cx = 0; cx < cells_x; ++cx) {
+			target[cy * cells_x + cx] = coverage(linear, width, cx * cell, cy * cell, cell, 1.0f);
+		}
+	}
+
+	for (unsigned int size = cell / 2, w = width / 2, h = height / 2; size >= 1 && levels.size() < MIP_MAX_LEVELS; size /= 2, w /= 2, h /= 2) {
+		linear = downsample(linear, w * 2, h * 2);
+		std::vector< float > alpha_scale(target.size(), 1.0f);
+		for (unsigned int cy = 0; cy < cells_y; ++cy) {
+			for (unsigned int cx = 0; cx < cells_x; ++cx) {
+				float want = target[cy * cells_x + cx];
+				//fully transparent or fully opaque cells have nothing to preserve:
+				if (want <= 0.0f || want >= 1.0f) continue;
+				if (coverage(linear, w, cx * size, cy * size, size, 1.0f) == want) continue;
+				//coverage only grows with scale, so binary search for the scale that matches:
+				float lo = 0.0f, hi = 4.0f;
+				for (unsigned int step = 0; step < 16; ++step) {
+					float mid = 0.5f * (lo + hi);
+					if (coverage(linear, w, cx * size, cy * size, size, mid) < want) lo = mid;
+					else hi = mid;
+				}
+				alpha_scale[cy * cells_x + cx] = hi;
+			}
+		}
+		levels.emplace_back(to_srgb(linear, w, h, size, alpha_scale));
+	}
+
+	for (auto &level : levels) {
+		premultiply_alpha(level.data(), level.size());
+	}
+
+	if (!save_mip_texture(out_filename, width, height, cell, levels, origin, alpha)) {
+		return 1;
+	}
+	std::cout << "Wrote " << levels.size() << " levels of " << width << "x" << height << " to '" << out_filename << "'." << std::endl;
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include "asset_pack.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//Packs files into an asset pack (see asset_pack.hpp), each under its file name without directories.
+//.mips files are laid out to be uploaded straight out of the mapping, so they're always stored raw.
+//usage: build_pack <out.pack> <file> [file ...]
+//(output first, so it can be run by jam's GenFile rule)
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <out.pack> <file> [file ...]" << std::endl;
+		return 1;
+	}
+	std::string out_filename = argv[1];
+
+	std::vector< PackInput > inputs;
+	for (int a = 2; a < argc; ++a) {
+		std::string filename = argv[a];
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open '" << filename << "'." << std::endl;
+			return 1;
+		}
+		inputs.emplace_back();
+		size_t slash = filename.find_last_of("/\\");
+		inputs.back().name = (slash == std::string::npos ? filename : filename.substr(slash + 1));
+		inputs.back().bytes.assign(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+		inputs.back().raw = (filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".mips") == 0);
+	}
+
+	if (!save_asset_pack(out_filename, inputs)) {
+		return 1;
+	}
+
+	//report what got stored how:
+	AssetPack pack;
+	if (!pack.open(out_filename)) {
+		return 1;
+	}
+	for (auto const &input : inputs) {
+		PackEntry const *entry = pack.find(input.name);
+		std::cout << "  " << input.name << ": " << entry->size << " bytes";
+		if (entry->compression == PackLZ4) std::cout << ", " << entry->stored_size << " as LZ4";
+		std::cout << std::endl;
+	}
+	std::cout << "Wrote " << inputs.size() << " entries (" << pack.size << " bytes) to '" << out_filename << "'." << std::endl;
+	return 0;
+}
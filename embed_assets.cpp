@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//Writes a C++ source file holding the given files as byte arrays (see embedded_assets.hpp).
+//usage: embed_assets <out.cpp> <file> [file ...]
+//(output first, so it can be run by jam's GenFile rule)
+
+//(matches the page size the .mips layout assumes)
+static const unsigned int EMBED_ALIGN = 4096;
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <out.cpp> <file> [file ...]" << std::endl;
+		return 1;
+	}
+	std::string out_filename = argv[1];
+
+	std::string out;
+	out += "//generated by embed_assets -- do not edit\n";
+	out += "#include \"embedded_assets.hpp\"\n\n";
+
+	std::vector< std::string > names;
+	std::vector< size_t > sizes;
+	for (int a = 2; a < argc; ++a) {
+		std::string filename = argv[a];
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open '" << filename << "'." << std::endl;
+			return 1;
+		}
+		std::vector< unsigned char > bytes((std::istreambuf_iterator< char >(file)), std::istreambuf_iterator< char >());
+
+		size_t slash = filename.find_last_of("/\\");
+		names.emplace_back(slash == std::string::npos ? filename : filename.substr(slash + 1));
+		sizes.emplace_back(bytes.size());
+
+		char line[64];
+		snprintf(line, sizeof(line), "alignas(%u) static const uint8_t asset_%u[] = {", EMBED_ALIGN, unsigned(a - 2));
+		out += line;
+		//(an empty array isn't allowed, so empty files get a single, uncounted, zero)
+		if (bytes.empty()) bytes.emplace_back(0);
+		for (size_t i = 0; i < bytes.size(); ++i) {
+			if (i % 16 == 0) out += "\n\t";
+			snprintf(line, sizeof(line), "0x%02x,", unsigned(bytes[i]));
+			out += line;
+		}
+		out += "\n};\n\n";
+	}
+
+	out += "EmbeddedAsset const embedded_assets[] = {\n";
+	for (size_t i = 0; i < names.size(); ++i) {
+		out += "\t{\"" + names[i] + "\", asset_" + std::to_string(i) + ", " + std::to_string(sizes[i]) + "},\n";
+	}
+	out += "};\n";
+	out += "size_t const embedded_asset_count = " + std::to_string(names.size()) + ";\n";
+
+	std::ofstream file(out_filename.c_str(), std::ios::binary);
+	file << out;
+	if (!file) {
+		std::cerr << "Failed to write '" << out_filename << "'." << std::endl;
+		file.close();
+		std::remove(out_filename.c_str());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,12 @@
+#include "embedded_assets.hpp"
+
+#include <cstring>
+
+EmbeddedAsset const *find_embedded_asset(std::string const &name) {
+	size_t slash = name.find_last_of("/\\");
+	std::string base = (slash == std::string::npos ? name : name.substr(slash + 1));
+	for (size_t i = 0; i < embedded_asset_count; ++i) {
+		if (base == embedded_assets[i].name) return &embedded_assets[i];
+	}
+	return nullptr;
+}
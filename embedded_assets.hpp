@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Assets compiled into the executable (by embed_assets, at build time) as read-only byte arrays.
+ * Each asset's bytes start on a page boundary, so formats laid out for mmap (.pack, .mips) keep
+ * their alignment when read straight out of the executable. (The build embeds the asset pack.)
+ */
+
+struct EmbeddedAsset {
+	char const *name; //file name the asset was built from, without directories
+	uint8_t const *data;
+	size_t size;
+};
+
+//(defined in the file embed_assets generates)
+extern EmbeddedAsset const embedded_assets[];
+extern size_t const embedded_asset_count;
+
+//asset embedded as 'name' (any directories are ignored), or nullptr if there isn't one:
+EmbeddedAsset const *find_embedded_asset(std::string const &name);
@@ -0,0 +1,54 @@
+#include "load_png_batch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <istream>
+
+PngBatch::PngBatch(std::vector< std::string > const &filenames, OriginLocation origin, Callback const &on_done, unsigned int threads) : next(0) {
+	start(filenames.size(), [filenames, origin](size_t index, PngImage *image) {
+		return load_png(filenames[index], &image->width, &image->height, &image->data, origin);
+	}, on_done, threads);
+}
+
+PngBatch::PngBatch(std::vector< std::istream * > const &streams, OriginLocation origin, Callback const &on_done, unsigned int threads) : next(0) {
+	start(streams.size(), [streams, origin](size_t index, PngImage *image) {
+		assert(streams[index]);
+		return load_png(*streams[index], &image->width, &image->height, &image->data, origin);
+	}, on_done, threads);
+}
+
+PngBatch::~PngBatch() {
+	wait();
+}
+
+void PngBatch::wait() {
+	for (auto &worker : workers) {
+		if (worker.joinable()) worker.join();
+	}
+}
+
+void PngBatch::start(size_t count, Job const &job, Callback const &on_done, unsigned int threads) {
+	//everything the workers touch is sized up front, so they never reallocate shared state:
+	images.resize(count);
+	promises.resize(count);
+	results.reserve(count);
+	for (auto &promise : promises) {
+		results.emplace_back(promise.get_future());
+	}
+
+	if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+	threads = unsigned(std::min< size_t >(threads, count));
+
+	//workers pull the next undecoded image until none are left:
+	for (unsigned int t = 0; t < threads; ++t) {
+		workers.emplace_back([this, job, on_done, count]() {
+			while (true) {
+				size_t index = next.fetch_add(1);
+				if (index >= count) break;
+				bool loaded = job(index, &images[index]);
+				if (on_done) on_done(index, loaded);
+				promises[index].set_value(loaded);
+			}
+		});
+	}
+}
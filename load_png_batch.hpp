@@ -0,0 +1,52 @@
+#pragma once
+
+#include "load_save_png.hpp"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Decode a batch of PNGs on a pool of worker threads.
+ * Each image gets a future (and, optionally, a callback run on the worker that decoded it)
+ * carrying the same true/false result load_png would have returned; errors are logged as
+ * load_png logs them.
+ * The destructor waits for any loads still in flight.
+ */
+
+struct PngImage {
+	unsigned int width = 0;
+	unsigned int height = 0;
+	std::vector< uint32_t > data;
+};
+
+struct PngBatch {
+	typedef std::function< void(size_t index, bool loaded) > Callback;
+
+	//threads == 0 uses one worker per hardware thread:
+	PngBatch(std::vector< std::string > const &filenames, OriginLocation origin, Callback const &on_done = Callback(), unsigned int threads = 0);
+	//streams must stay valid until their image is done:
+	PngBatch(std::vector< std::istream * > const &streams, OriginLocation origin, Callback const &on_done = Callback(), unsigned int threads = 0);
+	~PngBatch();
+	PngBatch(PngBatch const &) = delete;
+	PngBatch &operator=(PngBatch const &) = delete;
+
+	//block until every image has been decoded:
+	void wait();
+
+	//images[i] is safe to read once results[i] is ready:
+	std::vector< PngImage > images;
+	std::vector< std::future< bool > > results;
+
+private:
+	typedef std::function< bool(size_t index, PngImage *image) > Job;
+	void start(size_t count, Job const &job, Callback const &on_done, unsigned int threads);
+
+	std::vector< std::promise< bool > > promises;
+	std::vector< std::thread > workers;
+	std::atomic< size_t > next;
+};
@@ -1,4 +1,6 @@
 #include "load_save_png.hpp"
+#include "mapped_file.hpp"
+#include "premultiply_alpha.hpp"
 
 #include <png.h>
 
@@ -6,18 +8,21 @@
 #include <fstream>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
-bool load_png(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin) {
-	std::ifstream file(filename.c_str(), std::ios::binary);
-	if (!file) {
-		LOG_ERROR("  cannot open file.");
+bool load_png(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin, AlphaMode alpha) {
+	//decode straight out of the page cache rather than through an ifstream:
+	MappedFile file;
+	if (!file.open(filename)) {
 		return false;
 	}
-	return load_png(file, width, height, data, origin);
+	return load_png(file.data, file.size, width, height, data, origin, alpha);
 }
 
 void save_png(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
@@ -34,6 +39,21 @@ static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t lengt
 	}
 }
 
+struct MemoryReader {
+	uint8_t const *at;
+	uint8_t const *end;
+};
+
+static void memory_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
+	MemoryReader *from = reinterpret_cast< MemoryReader * >(png_get_io_ptr(png_ptr));
+	assert(from);
+	if (length > size_t(from->end - from->at)) {
+		png_error(png_ptr, "Error reading.");
+	}
+	memcpy(data, from->at, length);
+	from->at += length;
+}
+
 static void user_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
 	std::ostream *to = reinterpret_cast< std::ostream * >(png_get_io_ptr(png_ptr));
 	assert(to);
@@ -51,76 +71,457 @@ static void user_flush_data(png_structp png_ptr) {
 }
 
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin) {
+//read_png asks for its destination once the header (and so the output channel count) is known;
+// returns the first byte of the first row, or NULL to abort:
+typedef std::function< uint8_t *(unsigned int w, unsigned int h, unsigned int channels, size_t *stride_bytes) > PngDestination;
+
+//what read_png turns the file's pixels into:
+enum PngLayout {
+	RGBALayout, //8-bit RGBA, whatever the file holds
+	ReducedLayout, //8-bit gray or gray+alpha for gray files, else RGBA
+	IndexedLayout, //8-bit palette indices (palette files only), with the palette returned separately
+};
+
+static bool read_png(png_rw_ptr read_fn, void *io_ptr, unsigned int *width, unsigned int *height, unsigned int *channels, PngLayout layout, vector< uint32_t > *palette, PngDestination const &destination, OriginLocation origin, AlphaMode alpha);
+static bool read_png_info(png_rw_ptr read_fn, void *io_ptr, unsigned int *width, unsigned int *height, unsigned int *channels);
+
+//destination that (re)sizes a vector to exactly fit the image:
+static PngDestination vector_destination(vector< uint32_t > *data) {
+	assert(data);
+	data->clear();
+	return [data](unsigned int w, unsigned int h, unsigned int channels, size_t *stride_bytes) -> uint8_t * {
+		assert(channels == 4);
+		data->resize(size_t(w) * h);
+		*stride_bytes = size_t(w) * sizeof(uint32_t);
+		return reinterpret_cast< uint8_t * >(data->data());
+	};
+}
+
+static PngDestination vector_destination(vector< uint8_t > *data) {
+	assert(data);
+	data->clear();
+	return [data](unsigned int w, unsigned int h, unsigned int channels, size_t *stride_bytes) -> uint8_t * {
+		data->resize(size_t(w) * h * channels);
+		*stride_bytes = size_t(w) * channels;
+		return data->data();
+	};
+}
+
+//destination that checks the image fits caller-provided storage:
+static PngDestination buffer_destination(unsigned int width, unsigned int height, unsigned int channels, uint8_t *data, size_t stride_bytes) {
+	return [=](unsigned int w, unsigned int h, unsigned int c, size_t *stride_out) -> uint8_t * {
+		if (w != width || h != height || c != channels || stride_bytes < size_t(w) * c) {
+			LOG_ERROR("  image is " << w << "x" << h << "x" << c << ", but destination is " << width << "x" << height << "x" << channels << " (stride " << stride_bytes << " bytes).");
+			return NULL;
+		}
+		*stride_out = stride_bytes;
+		return data;
+	};
+}
+
+bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin, AlphaMode alpha) {
+	bool ret = read_png(user_read_data, &from, width, height, NULL, RGBALayout, NULL, vector_destination(data), origin, alpha);
+	if (!ret) data->clear();
+	return ret;
+}
+
+bool load_png(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin, AlphaMode alpha) {
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	bool ret = read_png(memory_read_data, &from, width, height, NULL, RGBALayout, NULL, vector_destination(data), origin, alpha);
+	if (!ret) data->clear();
+	return ret;
+}
+
+bool load_png(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin, AlphaMode alpha) {
+	assert(data);
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	return read_png(memory_read_data, &from, NULL, NULL, NULL, RGBALayout, NULL, buffer_destination(width, height, 4, reinterpret_cast< uint8_t * >(data), stride * sizeof(uint32_t)), origin, alpha);
+}
+
+bool load_png(std::string filename, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin, AlphaMode alpha) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_png(file.data, file.size, width, height, data, stride, origin, alpha);
+}
+
+bool load_png_channels(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, unsigned int *channels, vector< uint8_t > *data, OriginLocation origin, AlphaMode alpha) {
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	bool ret = read_png(memory_read_data, &from, width, height, channels, ReducedLayout, NULL, vector_destination(data), origin, alpha);
+	if (!ret) data->clear();
+	return ret;
+}
+
+bool load_png_channels(std::string filename, unsigned int *width, unsigned int *height, unsigned int *channels, vector< uint8_t > *data, OriginLocation origin, AlphaMode alpha) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_png_channels(file.data, file.size, width, height, channels, data, origin, alpha);
+}
+
+bool load_png_channels(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, unsigned int channels, uint8_t *data, size_t stride_bytes, OriginLocation origin, AlphaMode alpha) {
 	assert(data);
-	uint32_t local_width, local_height;
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	return read_png(memory_read_data, &from, NULL, NULL, NULL, ReducedLayout, NULL, buffer_destination(width, height, channels, data, stride_bytes), origin, alpha);
+}
+
+bool load_png_indexed(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, vector< uint8_t > *indices, vector< uint32_t > *palette, OriginLocation origin, AlphaMode alpha) {
+	assert(palette);
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	bool ret = read_png(memory_read_data, &from, width, height, NULL, IndexedLayout, palette, vector_destination(indices), origin, alpha);
+	if (!ret) {
+		indices->clear();
+		palette->clear();
+	}
+	return ret;
+}
+
+bool load_png_indexed(std::string filename, unsigned int *width, unsigned int *height, vector< uint8_t > *indices, vector< uint32_t > *palette, OriginLocation origin, AlphaMode alpha) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_png_indexed(file.data, file.size, width, height, indices, palette, origin, alpha);
+}
+
+bool load_png_info(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, unsigned int *channels) {
+	MemoryReader from;
+	from.at = bytes;
+	from.end = bytes + size;
+	return read_png_info(memory_read_data, &from, width, height, channels);
+}
+
+bool load_png_info(std::string filename, unsigned int *width, unsigned int *height, unsigned int *channels) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_png_info(file.data, file.size, width, height, channels);
+}
+
+//channels a reduced decode will produce for a file with this header:
+static unsigned int reduced_channels(png_structp png, png_infop info) {
+	png_byte color_type = png_get_color_type(png, info);
+	if (color_type == PNG_COLOR_TYPE_GRAY) {
+		return (png_get_valid(png, info, PNG_INFO_tRNS) ? 2 : 1);
+	} else if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+		return 2;
+	} else {
+		return 4;
+	}
+}
+
+static bool read_png_info(png_rw_ptr read_fn, void *io_ptr, unsigned int *width, unsigned int *height, unsigned int *channels) {
+	assert(width && height);
+	*width = *height = 0;
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
+	if (!png) {
+		LOG_ERROR("  cannot alloc read struct.");
+		return false;
+	}
+	png_set_read_fn(png, io_ptr, read_fn);
+	png_infop info = png_create_info_struct(png);
+	if (!info) {
+		LOG_ERROR("  cannot alloc info struct.");
+		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
+		return false;
+	}
+	if (setjmp(png_jmpbuf(png))) {
+		LOG_ERROR("  png interal error.");
+		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
+		return false;
+	}
+	//only the chunks up to the first IDAT are read:
+	png_read_info(png, info);
+	*width = png_get_image_width(png, info);
+	*height = png_get_image_height(png, info);
+	if (channels) *channels = reduced_channels(png, info);
+	png_destroy_read_struct(&png, &info, NULL);
+	return true;
+}
+
+//ask libpng to convert whatever is in the file to the requested layout; returns the output channel count
+// (or 0 if the file can't be read in that layout):
+static unsigned int set_transforms(png_structp png, png_infop info, PngLayout layout, int *passes) {
+	unsigned int channels = (layout == ReducedLayout ? reduced_channels(png, info) : 4);
+	if (layout == IndexedLayout) {
+		if (png_get_color_type(png, info) != PNG_COLOR_TYPE_PALETTE) {
+			LOG_ERROR("  not a palette image.");
+			return 0;
+		}
+		//indices only get unpacked to a byte each; the palette stays a palette:
+		channels = 1;
+		if (png_get_bit_depth(png, info) < 8)
+			png_set_packing(png);
+	} else if (channels < 4) {
+		if (png_get_bit_depth(png, info) < 8)
+			png_set_expand_gray_1_2_4_to_8(png);
+		if (png_get_valid(png, info, PNG_INFO_tRNS))
+			png_set_tRNS_to_alpha(png);
+	} else {
+		if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE)
+			png_set_palette_to_rgb(png);
+		if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_gray_to_rgb(png);
+		//a tRNS chunk becomes real alpha (gray and RGB images; palettes get this from palette_to_rgb):
+		if (png_get_valid(png, info, PNG_INFO_tRNS))
+			png_set_tRNS_to_alpha(png);
+		if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
+			png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+		if (png_get_bit_depth(png, info) < 8)
+			png_set_packing(png);
+	}
+	if (png_get_bit_depth(png,info) == 16)
+		png_set_strip_16(png);
+	//Ok, should be 8 bits per channel now.
+
+	*passes = png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+	assert(png_get_rowbytes(png, info) == png_get_image_width(png, info) * channels);
+	return channels;
+}
+
+static bool read_png(png_rw_ptr read_fn, void *io_ptr, unsigned int *width, unsigned int *height, unsigned int *channels, PngLayout layout, vector< uint32_t > *palette, PngDestination const &destination, OriginLocation origin, AlphaMode alpha) {
+	assert((layout == IndexedLayout) == (palette != NULL));
+	uint32_t local_width, local_height, local_channels;
 	if (width == nullptr) width = &local_width;
 	if (height == nullptr) height = &local_height;
-	*width = *height = 0;
-	data->clear();
+	if (channels == nullptr) channels = &local_channels;
+	*width = *height = *channels = 0;
 	//..... load file ......
 	//Load a png file, as per the libpng docs:
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
 
-	png_set_read_fn(png, &from, user_read_data);
-
 	if (!png) {
 		LOG_ERROR("  cannot alloc read struct.");
 		return false;
 	}
+
+	png_set_read_fn(png, io_ptr, read_fn);
 	png_infop info = png_create_info_struct(png);
 	if (!info) {
 		LOG_ERROR("  cannot alloc info struct.");
 		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
 		return false;
 	}
-	png_bytep *row_pointers = NULL;
 	if (setjmp(png_jmpbuf(png))) {
 		LOG_ERROR("  png interal error.");
 		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
 		return false;
 	}
 	//not needed with custom read/write functions: png_init_io(png, NULL);
 	png_read_info(png, info);
 	unsigned int w = png_get_image_width(png, info);
 	unsigned int h = png_get_image_height(png, info);
-	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE)
-		png_set_palette_to_rgb(png);
-	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
-		png_set_gray_to_rgb(png);
-	if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
-		png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
-	if (png_get_bit_depth(png, info) < 8)
-		png_set_packing(png);
-	if (png_get_bit_depth(png,info) == 16)
-		png_set_strip_16(png);
-	//Ok, should be 32-bit RGBA now.
+	int passes = 1;
+	unsigned int c = set_transforms(png, info, layout, &passes);
+	if (c == 0) {
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	if (palette) {
+		//palette as RGBA, with alpha from the tRNS chunk where it has entries:
+		png_colorp colors = NULL;
+		int color_count = 0;
+		png_get_PLTE(png, info, &colors, &color_count);
+		png_bytep alphas = NULL;
+		int alpha_count = 0;
+		if (png_get_valid(png, info, PNG_INFO_tRNS))
+			png_get_tRNS(png, info, &alphas, &alpha_count, NULL);
+		palette->assign(color_count, 0);
+		for (int i = 0; i < color_count; ++i) {
+			uint8_t rgba[4] = { colors[i].red, colors[i].green, colors[i].blue, uint8_t(i < alpha_count ? alphas[i] : 0xff) };
+			memcpy(&(*palette)[i], rgba, 4);
+		}
+		if (alpha == PremultipliedAlpha) premultiply_alpha(palette->data(), palette->size());
+	}
 
-	png_read_update_info(png, info);
-	unsigned int rowbytes = png_get_rowbytes(png, info);
-	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
+	size_t stride = 0;
+	uint8_t *pixels = destination(w, h, c, &stride);
+	if (!pixels) {
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	//rows are read in place, so no row pointer array (or any other per-image allocation) is needed:
+	for (int pass = 0; pass < passes; ++pass) {
+		for (unsigned int r = 0; r < h; ++r) {
+			unsigned int row = (origin == LowerLeftOrigin ? h-1-r : r);
+			png_read_row(png, (png_bytep)(pixels + row * stride), NULL);
+			//premultiply each row as it's finished, while it is still in cache:
+			if (alpha == PremultipliedAlpha && pass + 1 == passes && layout != IndexedLayout) {
+				if (c == 4) premultiply_alpha(reinterpret_cast< uint32_t * >(pixels + row * stride), w);
+				else if (c == 2) premultiply_gray_alpha(pixels + row * stride, w);
+			}
+		}
+	}
+	png_read_end(png, NULL);
+	png_destroy_read_struct(&png, &info, NULL);
+
+	*width = w;
+	*height = h;
+	*channels = c;
+	return true;
+}
+
+//state shared between load_png_progressive and libpng's progressive-reader callbacks:
+struct ProgressiveReader {
+	PngHeaderCallback const *on_header;
+	PngStripCallback const *on_strip;
+	OriginLocation origin;
+	unsigned int strip_rows;
 
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
-	for (unsigned int r = 0; r < h; ++r) {
+	unsigned int width = 0;
+	unsigned int height = 0;
+	bool interlaced = false;
+	bool cancelled = false;
+	bool finished = false;
+
+	//non-interlaced images: the strip being filled (rows [strip_begin, strip_begin + strip_count) of the file):
+	//interlaced images: the whole image, since every pass touches every strip:
+	vector< uint32_t > pixels;
+	unsigned int strip_begin = 0;
+	unsigned int strip_count = 0;
+	unsigned int strip_filled = 0;
+
+	void start_strip(unsigned int begin) {
+		strip_begin = begin;
+		strip_count = std::min(strip_rows, height - begin);
+		strip_filled = 0;
+	}
+	//hand out 'count' rows of 'rows', which start at file row 'begin' and are stored in origin order:
+	void emit(unsigned int begin, unsigned int count, uint32_t const *rows) {
 		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
+			(*on_strip)(height - begin - count, count, rows);
 		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+			(*on_strip)(begin, count, rows);
 		}
 	}
-	png_read_image(png, row_pointers);
+};
+
+static void progressive_info(png_structp png, png_infop info) {
+	ProgressiveReader *reader = reinterpret_cast< ProgressiveReader * >(png_get_progressive_ptr(png));
+	assert(reader);
+	reader->width = png_get_image_width(png, info);
+	reader->height = png_get_image_height(png, info);
+	int passes = 1;
+	set_transforms(png, info, RGBALayout, &passes);
+	reader->interlaced = (passes > 1);
+
+	if (!(*reader->on_header)(reader->width, reader->height)) {
+		reader->cancelled = true;
+		png_error(png, "Cancelled.");
+	}
+	if (reader->interlaced) {
+		reader->pixels.assign(size_t(reader->width) * reader->height, 0);
+	} else {
+		reader->pixels.resize(size_t(reader->width) * std::min(reader->strip_rows, reader->height));
+		reader->start_strip(0);
+	}
+}
+
+static void progressive_row(png_structp png, png_bytep new_row, png_uint_32 row_num, int pass) {
+	ProgressiveReader *reader = reinterpret_cast< ProgressiveReader * >(png_get_progressive_ptr(png));
+	assert(reader);
+	//(interlaced images may have no new data for a row in a given pass)
+	if (new_row == NULL || row_num >= reader->height) return;
+
+	if (reader->interlaced) {
+		unsigned int row = (reader->origin == LowerLeftOrigin ? reader->height - 1 - row_num : row_num);
+		png_progressive_combine_row(png, (png_bytep)&reader->pixels[size_t(row) * reader->width], new_row);
+		return;
+	}
+
+	assert(row_num == reader->strip_begin + reader->strip_filled);
+	unsigned int offset = row_num - reader->strip_begin;
+	unsigned int slot = (reader->origin == LowerLeftOrigin ? reader->strip_count - 1 - offset : offset);
+	memcpy(&reader->pixels[size_t(slot) * reader->width], new_row, reader->width * sizeof(uint32_t));
+	reader->strip_filled += 1;
+	if (reader->strip_filled == reader->strip_count) {
+		reader->emit(reader->strip_begin, reader->strip_count, &reader->pixels[0]);
+		if (reader->strip_begin + reader->strip_count < reader->height) {
+			reader->start_strip(reader->strip_begin + reader->strip_count);
+		}
+	}
+}
+
+static void progressive_end(png_structp png, png_infop info) {
+	ProgressiveReader *reader = reinterpret_cast< ProgressiveReader * >(png_get_progressive_ptr(png));
+	assert(reader);
+	if (reader->interlaced) {
+		//rows only became final with the last pass, so strips go out now:
+		for (unsigned int begin = 0; begin < reader->height; begin += reader->strip_rows) {
+			unsigned int count = std::min(reader->strip_rows, reader->height - begin);
+			size_t first = (reader->origin == LowerLeftOrigin ? reader->height - begin - count : begin);
+			reader->emit(begin, count, &reader->pixels[first * reader->width]);
+		}
+	}
+	reader->finished = true;
+}
+
+bool load_png_progressive(std::istream &from, PngHeaderCallback const &on_header, PngStripCallback const &on_strip, OriginLocation origin, unsigned int strip_rows) {
+	assert(on_header);
+	assert(on_strip);
+	ProgressiveReader reader;
+	reader.on_header = &on_header;
+	reader.on_strip = &on_strip;
+	reader.origin = origin;
+	reader.strip_rows = std::max(1U, strip_rows);
+	vector< char > chunk(1 << 16);
+
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
+	if (!png) {
+		LOG_ERROR("  cannot alloc read struct.");
+		return false;
+	}
+	png_infop info = png_create_info_struct(png);
+	if (!info) {
+		LOG_ERROR("  cannot alloc info struct.");
+		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
+		return false;
+	}
+	if (setjmp(png_jmpbuf(png))) {
+		if (!reader.cancelled) LOG_ERROR("  png interal error.");
+		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
+		return false;
+	}
+	png_set_progressive_read_fn(png, &reader, progressive_info, progressive_row, progressive_end);
+
+	//feed the file to libpng a chunk at a time; it calls back as rows are completed:
+	while (!reader.finished) {
+		from.read(&chunk[0], chunk.size());
+		std::streamsize got = from.gcount();
+		if (got <= 0) break;
+		png_process_data(png, info, (png_bytep)&chunk[0], size_t(got));
+	}
 	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
 
-	*width = w;
-	*height = h;
+	if (!reader.finished) {
+		LOG_ERROR("  png data is truncated.");
+		return false;
+	}
 	return true;
 }
 
+bool load_png_progressive(std::string filename, PngHeaderCallback const &on_header, PngStripCallback const &on_strip, OriginLocation origin, unsigned int strip_rows) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		LOG_ERROR("  cannot open file.");
+		return false;
+	}
+	return load_png_progressive(file, on_header, on_strip, origin, strip_rows);
+}
 
 void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
 //After the libpng example.c
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <stddef.h>
 
 /*
  * Load and save PNG files.
+ * Loading by filename memory-maps the file and decodes directly from the mapping.
  */
 
 enum OriginLocation {
@@ -13,8 +16,53 @@ enum OriginLocation {
 	UpperLeftOrigin,
 };
 
-bool load_png(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin);
+//PremultipliedAlpha scales color by alpha as rows are decoded (for GL_ONE, GL_ONE_MINUS_SRC_ALPHA blending):
+enum AlphaMode {
+	StraightAlpha,
+	PremultipliedAlpha,
+};
+
+bool load_png(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin, AlphaMode alpha = StraightAlpha);
 void save_png(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin);
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin);
+bool load_png(std::istream &from, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
 void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin = UpperLeftOrigin);
+
+//decode from a caller-owned buffer holding a whole PNG file (no copies, no stream overhead):
+bool load_png(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
+
+//read just the header, e.g. to size storage before decoding into it
+// (channels, if given, is what load_png_channels will produce: 1, 2 or 4):
+bool load_png_info(std::string filename, unsigned int *width, unsigned int *height, unsigned int *channels = nullptr);
+bool load_png_info(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, unsigned int *channels = nullptr);
+
+//decode into caller-provided storage (not cleared first) with rows 'stride' pixels apart;
+// fails if the image isn't exactly width x height:
+bool load_png(std::string filename, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin, AlphaMode alpha = StraightAlpha);
+bool load_png(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
+
+//streaming decode for images too big to hold decoded: rows are handed to on_strip in strips of up to
+// strip_rows rows as soon as libpng has inflated them, so only one strip is held in memory at a time.
+//on_header gets the image size first and may return false to cancel the load.
+//on_strip(first_row, row_count, pixels) gets row_count full rows in origin order (i.e. with LowerLeftOrigin,
+// the bottom row of the strip comes first and first_row counts from the bottom, ready for glTexSubImage2D).
+//(interlaced images can't be streamed this way; they are buffered whole and handed out at the end.)
+typedef std::function< bool(unsigned int width, unsigned int height) > PngHeaderCallback;
+typedef std::function< void(unsigned int first_row, unsigned int row_count, uint32_t const *pixels) > PngStripCallback;
+bool load_png_progressive(std::string filename, PngHeaderCallback const &on_header, PngStripCallback const &on_strip, OriginLocation origin, unsigned int strip_rows = 16);
+bool load_png_progressive(std::istream &from, PngHeaderCallback const &on_header, PngStripCallback const &on_strip, OriginLocation origin = UpperLeftOrigin, unsigned int strip_rows = 16);
+
+//decode a palette image without expanding it: one byte per pixel holding its palette index (rows tightly
+// packed), plus the palette as RGBA with alpha from the tRNS chunk (premultiplied with PremultipliedAlpha).
+//fails (and logs) for images that aren't palette images:
+bool load_png_indexed(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint8_t > *indices, std::vector< uint32_t > *palette, OriginLocation origin, AlphaMode alpha = StraightAlpha);
+bool load_png_indexed(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, std::vector< uint8_t > *indices, std::vector< uint32_t > *palette, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
+
+//decode without widening gray data: gray images come back as 1 byte per pixel (R8), gray+alpha
+// (or gray with a tRNS chunk) as 2 bytes per pixel (RG8), anything else as RGBA8 as with load_png.
+//*channels is set to 1, 2 or 4; rows are tightly packed (width*channels bytes) in the vector versions.
+//with PremultipliedAlpha, gray+alpha data has its gray premultiplied; a lone gray channel is left alone.
+bool load_png_channels(std::string filename, unsigned int *width, unsigned int *height, unsigned int *channels, std::vector< uint8_t > *data, OriginLocation origin, AlphaMode alpha = StraightAlpha);
+bool load_png_channels(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, unsigned int *channels, std::vector< uint8_t > *data, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
+//caller-storage version, rows 'stride_bytes' apart; fails unless the image is exactly width x height x channels:
+bool load_png_channels(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, unsigned int channels, uint8_t *data, size_t stride_bytes, OriginLocation origin = UpperLeftOrigin, AlphaMode alpha = StraightAlpha);
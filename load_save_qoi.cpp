@@ -0,0 +1,275 @@
+#include "load_save_qoi.hpp"
+#include "mapped_file.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cassert>
+#include <vector>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+using std::vector;
+
+//See https://qoiformat.org/qoi-specification.pdf for the format.
+
+static const uint8_t QOI_OP_INDEX = 0x00; //00xxxxxx
+static const uint8_t QOI_OP_DIFF  = 0x40; //01xxxxxx
+static const uint8_t QOI_OP_LUMA  = 0x80; //10xxxxxx
+static const uint8_t QOI_OP_RUN   = 0xc0; //11xxxxxx
+static const uint8_t QOI_OP_RGB   = 0xfe; //11111110
+static const uint8_t QOI_OP_RGBA  = 0xff; //11111111
+static const uint8_t QOI_MASK_2   = 0xc0;
+
+static const size_t QOI_HEADER_SIZE = 14;
+static const uint8_t QOI_PADDING[8] = {0,0,0,0,0,0,0,1};
+//same limit as the reference implementation, keeps w*h*4 well inside 32 bits:
+static const uint64_t QOI_PIXELS_MAX = 400000000;
+
+struct QoiPixel {
+	uint8_t r, g, b, a;
+};
+static_assert(sizeof(QoiPixel) == sizeof(uint32_t), "QoiPixel matches RGBA8 layout.");
+
+static inline unsigned int qoi_hash(QoiPixel const &p) {
+	return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+static inline bool operator==(QoiPixel const &a, QoiPixel const &b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static inline uint32_t read_u32(uint8_t const *at) {
+	return (uint32_t(at[0]) << 24) | (uint32_t(at[1]) << 16) | (uint32_t(at[2]) << 8) | uint32_t(at[3]);
+}
+
+static inline void write_u32(vector< uint8_t > *to, uint32_t val) {
+	to->push_back(uint8_t(val >> 24));
+	to->push_back(uint8_t(val >> 16));
+	to->push_back(uint8_t(val >> 8));
+	to->push_back(uint8_t(val));
+}
+
+bool load_qoi_info(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height) {
+	assert(width && height);
+	*width = *height = 0;
+	if (size < QOI_HEADER_SIZE + sizeof(QOI_PADDING)) {
+		LOG_ERROR("  file too small to be a qoi image.");
+		return false;
+	}
+	if (bytes[0] != 'q' || bytes[1] != 'o' || bytes[2] != 'i' || bytes[3] != 'f') {
+		LOG_ERROR("  not a qoi image.");
+		return false;
+	}
+	uint32_t w = read_u32(bytes + 4);
+	uint32_t h = read_u32(bytes + 8);
+	uint8_t channels = bytes[12];
+	if (w == 0 || h == 0 || (channels != 3 && channels != 4) || uint64_t(w) * h > QOI_PIXELS_MAX) {
+		LOG_ERROR("  invalid qoi header.");
+		return false;
+	}
+	*width = w;
+	*height = h;
+	return true;
+}
+
+bool load_qoi_info(std::string filename, unsigned int *width, unsigned int *height) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_qoi_info(file.data, file.size, width, height);
+}
+
+bool load_qoi(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin) {
+	assert(data);
+	unsigned int w, h;
+	if (!load_qoi_info(bytes, size, &w, &h)) return false;
+	if (w != width || h != height || stride < w) {
+		LOG_ERROR("  image is " << w << "x" << h << ", but destination is " << width << "x" << height << " (stride " << stride << ").");
+		return false;
+	}
+
+	QoiPixel index[64] = {};
+	QoiPixel px = {0, 0, 0, 255};
+	uint8_t const *at = bytes + QOI_HEADER_SIZE;
+	//the padding is never part of a chunk, so running into it means the data is truncated:
+	uint8_t const *end = bytes + size - sizeof(QOI_PADDING);
+	unsigned int run = 0;
+
+	for (unsigned int r = 0; r < h; ++r) {
+		unsigned int row = (origin == LowerLeftOrigin ? h-1-r : r);
+		QoiPixel *out = reinterpret_cast< QoiPixel * >(data + row * stride);
+		for (unsigned int x = 0; x < w; ++x) {
+			if (run > 0) {
+				--run;
+			} else {
+				if (at >= end) {
+					LOG_ERROR("  qoi data is truncated.");
+					return false;
+				}
+				uint8_t b1 = *(at++);
+				if (b1 == QOI_OP_RGB) {
+					if (end - at < 3) {
+						LOG_ERROR("  qoi data is truncated.");
+						return false;
+					}
+					px.r = at[0]; px.g = at[1]; px.b = at[2];
+					at += 3;
+				} else if (b1 == QOI_OP_RGBA) {
+					if (end - at < 4) {
+						LOG_ERROR("  qoi data is truncated.");
+						return false;
+					}
+					px.r = at[0]; px.g = at[1]; px.b = at[2]; px.a = at[3];
+					at += 4;
+				} else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+					px = index[b1];
+				} else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+					px.r += ((b1 >> 4) & 0x03) - 2;
+					px.g += ((b1 >> 2) & 0x03) - 2;
+					px.b += ( b1       & 0x03) - 2;
+				} else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+					if (at >= end) {
+						LOG_ERROR("  qoi data is truncated.");
+						return false;
+					}
+					uint8_t b2 = *(at++);
+					int vg = (b1 & 0x3f) - 32;
+					px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+					px.g += vg;
+					px.b += vg - 8 +  (b2       & 0x0f);
+				} else { //QOI_OP_RUN
+					run = (b1 & 0x3f);
+				}
+				index[qoi_hash(px)] = px;
+			}
+			out[x] = px;
+		}
+	}
+	return true;
+}
+
+bool load_qoi(std::string filename, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_qoi(file.data, file.size, width, height, data, stride, origin);
+}
+
+bool load_qoi(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin) {
+	assert(data);
+	uint32_t local_width, local_height;
+	if (width == nullptr) width = &local_width;
+	if (height == nullptr) height = &local_height;
+	*width = *height = 0;
+	data->clear();
+
+	unsigned int w, h;
+	if (!load_qoi_info(bytes, size, &w, &h)) return false;
+	data->resize(size_t(w) * h);
+	if (!load_qoi(bytes, size, w, h, data->data(), w, origin)) {
+		data->clear();
+		return false;
+	}
+	*width = w;
+	*height = h;
+	return true;
+}
+
+bool load_qoi(std::string filename, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	return load_qoi(file.data, file.size, width, height, data, origin);
+}
+
+bool load_qoi(std::istream &from, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin) {
+	vector< uint8_t > bytes((std::istreambuf_iterator< char >(from)), std::istreambuf_iterator< char >());
+	return load_qoi(bytes.data(), bytes.size(), width, height, data, origin);
+}
+
+
+void save_qoi(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	save_qoi(file, width, height, data, origin);
+}
+
+void save_qoi(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
+	if (width == 0 || height == 0 || uint64_t(width) * height > QOI_PIXELS_MAX) {
+		LOG_ERROR("Can't write a " << width << "x" << height << " qoi.");
+		return;
+	}
+
+	//encode into memory, then hand the stream a single write:
+	vector< uint8_t > bytes;
+	//worst case is one QOI_OP_RGBA per pixel:
+	bytes.reserve(QOI_HEADER_SIZE + size_t(width) * height * 5 + sizeof(QOI_PADDING));
+
+	bytes.push_back('q'); bytes.push_back('o'); bytes.push_back('i'); bytes.push_back('f');
+	write_u32(&bytes, width);
+	write_u32(&bytes, height);
+	bytes.push_back(4); //channels
+	bytes.push_back(0); //colorspace: sRGB with linear alpha
+
+	QoiPixel index[64] = {};
+	QoiPixel prev = {0, 0, 0, 255};
+	unsigned int run = 0;
+
+	for (unsigned int i = 0; i < height; ++i) {
+		unsigned int row = (origin == UpperLeftOrigin ? i : height - 1 - i);
+		QoiPixel const *in = reinterpret_cast< QoiPixel const * >(data + size_t(row) * width);
+		for (unsigned int x = 0; x < width; ++x) {
+			QoiPixel px = in[x];
+			if (px == prev) {
+				++run;
+				if (run == 62) {
+					bytes.push_back(QOI_OP_RUN | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				bytes.push_back(QOI_OP_RUN | (run - 1));
+				run = 0;
+			}
+
+			unsigned int hash = qoi_hash(px);
+			if (index[hash] == px) {
+				bytes.push_back(QOI_OP_INDEX | hash);
+			} else {
+				index[hash] = px;
+				if (px.a == prev.a) {
+					int8_t vr = int8_t(px.r - prev.r);
+					int8_t vg = int8_t(px.g - prev.g);
+					int8_t vb = int8_t(px.b - prev.b);
+					int8_t vg_r = int8_t(vr - vg);
+					int8_t vg_b = int8_t(vb - vg);
+					if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+						bytes.push_back(QOI_OP_DIFF | uint8_t((vr + 2) << 4) | uint8_t((vg + 2) << 2) | uint8_t(vb + 2));
+					} else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+						bytes.push_back(QOI_OP_LUMA | uint8_t(vg + 32));
+						bytes.push_back(uint8_t((vg_r + 8) << 4) | uint8_t(vg_b + 8));
+					} else {
+						bytes.push_back(QOI_OP_RGB);
+						bytes.push_back(px.r); bytes.push_back(px.g); bytes.push_back(px.b);
+					}
+				} else {
+					bytes.push_back(QOI_OP_RGBA);
+					bytes.push_back(px.r); bytes.push_back(px.g); bytes.push_back(px.b); bytes.push_back(px.a);
+				}
+			}
+			prev = px;
+		}
+	}
+	if (run > 0) {
+		bytes.push_back(QOI_OP_RUN | (run - 1));
+	}
+	bytes.insert(bytes.end(), QOI_PADDING, QOI_PADDING + sizeof(QOI_PADDING));
+
+	if (!to.write(reinterpret_cast< char const * >(bytes.data()), bytes.size())) {
+		LOG_ERROR("Error writing qoi.");
+	}
+}
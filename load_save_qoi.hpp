@@ -0,0 +1,27 @@
+#pragma once
+
+#include "load_save_png.hpp"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Load and save QOI ("Quite OK Image") files.
+ * Same interface as the PNG functions; decoding is a single pass over the file with no inflate step.
+ */
+
+bool load_qoi(std::string filename, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin);
+void save_qoi(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin);
+
+bool load_qoi(std::istream &from, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin);
+void save_qoi(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin = UpperLeftOrigin);
+
+bool load_qoi(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin);
+
+//header-only and caller-provided-storage variants, as for load_png:
+bool load_qoi_info(std::string filename, unsigned int *width, unsigned int *height);
+bool load_qoi_info(uint8_t const *bytes, size_t size, unsigned int *width, unsigned int *height);
+bool load_qoi(std::string filename, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin);
+bool load_qoi(uint8_t const *bytes, size_t size, unsigned int width, unsigned int height, uint32_t *data, size_t stride, OriginLocation origin = UpperLeftOrigin);
@@ -0,0 +1,136 @@
+#include "lz4.hpp"
+
+#include <cstring>
+#include <vector>
+
+//format constants (see the block format description):
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5; //a block always ends with at least this many literals...
+static const size_t MATCH_LIMIT = 12; //...and no match starts within this many bytes of the end
+static const size_t MAX_OFFSET = 65535;
+
+static const unsigned int HASH_BITS = 12;
+
+static uint32_t read32(uint8_t const *at) {
+	uint32_t v;
+	memcpy(&v, at, sizeof(v));
+	return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+//length fields longer than a nybble continue in 255-valued bytes:
+static uint8_t *write_length(uint8_t *out, size_t length) {
+	for (; length >= 255; length -= 255) *(out++) = 255;
+	*(out++) = uint8_t(length);
+	return out;
+}
+
+size_t lz4_compress_bound(size_t size) {
+	return size + size / 255 + 16;
+}
+
+size_t lz4_compress(uint8_t const *data, size_t size, uint8_t *out) {
+	uint8_t *const out_begin = out;
+	uint8_t const *const end = data + size;
+	uint8_t const *anchor = data; //start of pending literals
+
+	auto emit = [&out, &anchor](uint8_t const *literals_end, size_t match_length, size_t offset) {
+		size_t literals = literals_end - anchor;
+		uint8_t *token = out++;
+		*token = uint8_t((literals < 15 ? literals : 15) << 4);
+		if (literals >= 15) out = write_length(out, literals - 15);
+		if (literals) memcpy(out, anchor, literals);
+		out += literals;
+		if (match_length == 0) return; //(the final, literals-only, sequence)
+		*(out++) = uint8_t(offset);
+		*(out++) = uint8_t(offset >> 8);
+		size_t extra = match_length - MIN_MATCH;
+		*token |= uint8_t(extra < 15 ? extra : 15);
+		if (extra >= 15) out = write_length(out, extra - 15);
+	};
+
+	if (size > MATCH_LIMIT) {
+		//last position (plus one) a match may start at, and may extend to:
+		uint8_t const *const match_start_limit = end - MATCH_LIMIT;
+		uint8_t const *const match_end_limit = end - LAST_LITERALS;
+		std::vector< uint32_t > table(size_t(1) << HASH_BITS, 0); //(position + 1; 0 is empty)
+
+		uint8_t const *at = data;
+		//(like the reference encoder, step faster through data that isn't matching -- e.g., already-compressed files)
+		size_t misses = 0;
+		while (at < match_start_limit) {
+			uint32_t v = read32(at);
+			uint32_t &slot = table[hash4(v)];
+			uint8_t const *candidate = (slot ? data + (slot - 1) : nullptr);
+			slot = uint32_t(at - data) + 1;
+			if (!candidate || size_t(at - candidate) > MAX_OFFSET || read32(candidate) != v) {
+				at += 1 + (misses++ >> 6);
+				continue;
+			}
+			//extend forward, then back over pending literals:
+			uint8_t const *match_end = at + MIN_MATCH;
+			while (match_end < match_end_limit && *match_end == candidate[match_end - at]) ++match_end;
+			while (at > anchor && candidate > data && at[-1] == candidate[-1]) {
+				--at;
+				--candidate;
+			}
+			misses = 0;
+			emit(at, match_end - at, at - candidate);
+			at = anchor = match_end;
+			//(seed the table inside the match so the next search can find it)
+			if (at - 2 > data && at < match_start_limit) table[hash4(read32(at - 2))] = uint32_t(at - 2 - data) + 1;
+		}
+	}
+	emit(end, 0, 0);
+	return size_t(out - out_begin);
+}
+
+bool lz4_decompress(uint8_t const *block, size_t block_size, uint8_t *out, size_t size) {
+	uint8_t const *in = block;
+	uint8_t const *const in_end = block + block_size;
+	uint8_t *const out_begin = out;
+	uint8_t *const out_end = out + size;
+
+	auto read_length = [&in, in_end](size_t *length) {
+		uint8_t b;
+		do {
+			if (in >= in_end) return false;
+			b = *(in++);
+			*length += b;
+		} while (b == 255);
+		return true;
+	};
+
+	while (in < in_end) {
+		uint8_t token = *(in++);
+		size_t literals = token >> 4;
+		if (literals == 15 && !read_length(&literals)) return false;
+		if (literals > size_t(in_end - in) || literals > size_t(out_end - out)) return false;
+		if (literals) memcpy(out, in, literals);
+		in += literals;
+		out += literals;
+		if (in == in_end) break; //(the last sequence has no match)
+
+		if (in_end - in < 2) return false;
+		size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+		in += 2;
+		size_t length = token & 0xf;
+		if (length == 15 && !read_length(&length)) return false;
+		length += MIN_MATCH;
+		if (offset == 0 || offset > size_t(out - out_begin) || length > size_t(out_end - out)) return false;
+		uint8_t const *from = out - offset;
+		if (offset >= length) {
+			memcpy(out, from, length);
+		} else if (offset == 1) {
+			memset(out, *from, length);
+		} else {
+			//(the match overlaps its own output, so copy forward a byte at a time)
+			for (size_t i = 0; i < length; ++i) out[i] = from[i];
+		}
+		out += length;
+	}
+	return out == out_end;
+}
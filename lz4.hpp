@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), compression and
+ * decompression. Blocks are interchangeable with the reference library's LZ4_compress_default and
+ * LZ4_decompress_safe; the compressor is the plain greedy, single-probe kind -- quick rather than tight.
+ * (There's no frame format: callers store sizes themselves.)
+ */
+
+//largest block lz4_compress can produce from 'size' bytes:
+size_t lz4_compress_bound(size_t size);
+
+//compresses 'size' bytes into 'out' (which must hold lz4_compress_bound(size) bytes); returns the block size:
+size_t lz4_compress(uint8_t const *data, size_t size, uint8_t *out);
+
+//decompresses a block that must come out to exactly 'size' bytes; returns false if the block is malformed,
+// never reading or writing outside the given buffers:
+bool lz4_decompress(uint8_t const *block, size_t block_size, uint8_t *out, size_t size);
@@ -1,22 +1,81 @@
 #include "load_save_png.hpp"
+#include "load_save_qoi.hpp"
+#include "texture_cache.hpp"
+#include "mapped_file.hpp"
+#include "premultiply_alpha.hpp"
+#include "texture_upload.hpp"
+#include "texture_reload.hpp"
+#include "mip_texture.hpp"
+#include "block_compress.hpp"
+#include "sprite_table.hpp"
+#include "embedded_assets.hpp"
+#include "asset_pack.hpp"
+#include "asset_loader.hpp"
+#include "stream_buffer.hpp"
 #include "GL.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <vector>
 
 static GLuint compile_shader(GLenum type, std::string const &source);
 static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader);
+static bool is_qoi(std::string const &filename);
+static bool is_mips(std::string const &filename);
+static bool load_image(std::string const &filename, CachedImage *image, OriginLocation origin, AlphaMode alpha);
+static bool has_gl_extension(char const *name);
+static void upload_rgba_level(unsigned int level, unsigned int width, unsigned int height, uint32_t const *pixels, std::vector< uint8_t > const *blocks, BlockFormat format);
 
 int main(int argc, char **argv) {
 	//Configuration:
 	struct {
 		std::string title = "Game1: Text/Tiles";
 		glm::uvec2 size = glm::uvec2(480, 672);
+		std::string textures = "textures.mips"; //.mips (built from textures.png by build_mips), .png or .qoi
+		std::string sprites = "textures.sprites"; //where sprites are in textures (written by pack_atlas)
+		//textures and sprites are looked for in this pack (written by build_pack) before the working directory:
+		std::string pack = "assets.pack";
+		//use the copy of the pack compiled into the executable, if it has one (otherwise the pack file is mapped):
+		bool embedded_assets = true;
+		//decode .png textures on a worker, straight into a pixel unpack buffer, instead of through the
+		// pixel cache; frames are presented (without sprites) until the upload lands:
+		bool async_upload = false;
+		//block-compress RGBA textures (BC1/BC3) at load, if the driver takes S3TC:
+		bool compress_textures = true;
+		//textures is a palette .png (not a .mips -- point it at the .png): keep its indices as GL_R8 and look colors up in the shader
+		// (swapping the palette texture then recolors everything for free):
+		bool indexed_textures = false;
+		//PNG to watch for edits to the texture's level 0 (e.g. "textures.png", which textures.mips is built from);
+		// changed tiles are re-uploaded while the game runs. Turns off compress_textures; not for async_upload
+		// or indexed_textures. Empty to not watch:
+		std::string hot_reload = "";
+		//draw tiles (grid pieces, rock, player, treasure) from layers of a GL_TEXTURE_2D_ARRAY cut from the
+		// atlas -- each with its own mip chain -- instead of from atlas rects (needs an RGBA texture; not with hot_reload):
+		bool tile_array = true;
+		//stream sprite vertices through a persistently mapped buffer, if the driver has GL_ARB_buffer_storage
+		// (otherwise -- or if this is off -- each frame's vertices are mapped with GL_MAP_UNSYNCHRONIZED_BIT):
+		bool persistent_buffers = true;
+		//how sprites get to the GPU -- "strip": six vertices each, joined into one triangle strip;
+		// "instanced": one record each, which the vertex shader expands against a static quad;
+		// "pulled": one record each, in a buffer texture the vertex shader fetches from by gl_VertexID (no attributes):
+		std::string sprite_renderer = "instanced";
+		//for the strip renderer: 12-byte vertices (16-bit normalized positions and texture coordinates, an RGB tint,
+		// and the tile array layer) rather than 24-byte ones (float positions and texture coordinates, an RGBA tint).
+		// Positions then have to be within [-1,1] -- as they are, with the identity mvp -- so turn this off for larger world coordinates.
+		// Tints are RGB only on this path (translucent tints need float vertices, or another renderer), and
+		// float vertices are used anyway if the tile array has 255 or more layers.
+		bool compact_vertices = true;
 	} config;
 
 	//------------ initialization ------------
@@ -81,28 +140,82 @@ int main(int argc, char **argv) {
 
 	//------------ opengl objects / game assets ------------
 
-	//texture:
-	GLuint tex = 0;
-	glm::uvec2 tex_size = glm::uvec2(0,0);
+	//Assets are read and decoded by 'loader' on a worker thread while the game loop presents placeholder
+	// frames; the GL objects for each asset are made (on this thread) as it arrives. Jobs are added below,
+	// in the order they're needed, and the loader is started once they all are.
+	AssetLoader loader;
+
+	//asset pack (raw entries are used straight out of it, so it stays open for the whole run):
+	AssetPack pack;
+	loader.add("asset pack", [&]() {
+		EmbeddedAsset const *embedded = (config.embedded_assets ? find_embedded_asset(config.pack) : nullptr);
+		if (embedded ? !pack.open(embedded->data, embedded->size) : !pack.open(config.pack)) {
+			std::cerr << "NOTE: no asset pack; loading assets from the working directory." << std::endl;
+		}
+		return true;
+	}, nullptr);
 
-	{ //load texture 'tex':
-		std::vector< uint32_t > data;
-		if (!load_png("textures.png", &tex_size.x, &tex_size.y, &data, LowerLeftOrigin)) {
-			std::cerr << "Failed to load texture." << std::endl;
-			exit(1);
+	//tiles the tile array holds (if config.tile_array), one layer each:
+	std::vector< std::string > const tile_names = {"grid0", "grid1", "grid2", "grid3", "grid4", "rock", "player", "treasure"};
+
+	struct Vertex {
+		Vertex(glm::vec2 const &Position_, glm::vec3 const &TexCoord_, glm::u8vec4 const &Color_) :
+			Position(Position_), TexCoord(TexCoord_), Color(Color_) { }
+		glm::vec2 Position;
+		glm::vec3 TexCoord; //layer of the tile array in z, or -1 for the atlas
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 24, "Vertex is nicely packed.");
+
+	//...or, quantized (config.compact_vertices, when there are few enough tiles for a byte of layer):
+	const size_t COMPACT_MAX_LAYERS = 0xff; //(0xff itself means the atlas)
+	struct CompactVertex {
+		//(positions outside [-1,1] can't be represented -- clamping them would bend the quad rather than
+		// clip it -- so they're a caller error, as are layers the byte can't hold and translucent tints (which
+		// would come out opaque); the clamps just keep release builds from overflowing)
+		CompactVertex(glm::vec2 const &Position_, glm::vec3 const &TexCoord_, glm::u8vec4 const &Color_) :
+			Position(glm::round(glm::clamp(Position_, -1.0f, 1.0f) * 32767.0f)),
+			TexCoord(glm::round(glm::clamp(glm::vec2(TexCoord_.x, TexCoord_.y), 0.0f, 1.0f) * 65535.0f)),
+			Color(Color_.x, Color_.y, Color_.z), Layer(TexCoord_.z < 0.0f ? 0xff : uint8_t(TexCoord_.z)) {
+			//(to within a step, since quads drawn right up to the edge can land a rounding error past it)
+			assert(std::abs(Position_.x) <= 1.0f + 1.0f / 32767.0f && std::abs(Position_.y) <= 1.0f + 1.0f / 32767.0f);
+			assert(TexCoord_.z < float(COMPACT_MAX_LAYERS));
+			assert(Color_.w == 0xff);
 		}
-		//create a texture object:
-		glGenTextures(1, &tex);
-		//bind texture object to GL_TEXTURE_2D:
-		glBindTexture(GL_TEXTURE_2D, tex);
-		//upload texture data from data:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_size.x, tex_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, &data[0]);
-		//set texture sampling parameters:
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glm::i16vec2 Position; //normalized, [-1,1]
+		glm::u16vec2 TexCoord; //normalized, [0,1]
+		glm::u8vec3 Color; //(no alpha -- sprite tints are opaque)
+		uint8_t Layer; //layer of the tile array, or 0xff for the atlas
+	};
+	static_assert(sizeof(CompactVertex) == 12, "CompactVertex is nicely packed.");
+
+	//...or, for the instanced renderer, one record per sprite:
+	struct SpriteInstance {
+		SpriteInstance(glm::vec2 const &At_, float Angle_, float Layer_, glm::vec4 const &Rect_, glm::vec4 const &UVRect_, glm::u8vec4 const &Tint_) :
+			At(At_), Angle(Angle_), Layer(Layer_), Rect(Rect_), UVRect(glm::round(UVRect_ * 65535.0f)), Tint(Tint_) { }
+		glm::vec2 At; //where the sprite is drawn
+		float Angle;
+		float Layer; //layer of the tile array, or -1 for the atlas
+		glm::vec4 Rect; //corners of the quad relative to At, before rotation (min.x, min.y, max.x, max.y)
+		glm::u16vec4 UVRect; //texture coordinates of those corners, normalized (min.x, min.y, max.x, max.y)
+		glm::u8vec4 Tint;
+	};
+	static_assert(sizeof(SpriteInstance) == 44, "SpriteInstance is nicely packed.");
+
+	//...and the pulled renderer uses the same records, padded out to whole texels of a GL_RGBA32UI buffer texture:
+	const size_t TEXELS_PER_RECORD = 3;
+	static_assert(sizeof(SpriteInstance) <= TEXELS_PER_RECORD * sizeof(glm::uvec4), "SpriteInstance fits in its texels.");
+
+	bool instanced = (config.sprite_renderer == "instanced");
+	bool pulled = (config.sprite_renderer == "pulled");
+	//(more tiles than CompactVertex has layers for need float vertices)
+	bool compact = (!instanced && !pulled && config.compact_vertices && (!config.tile_array || tile_names.size() < COMPACT_MAX_LAYERS));
+	if (!instanced && !pulled && config.compact_vertices && !compact) {
+		std::cerr << "NOTE: " << tile_names.size() << " tiles are too many for compact vertices; using float vertices." << std::endl;
 	}
+	//bytes of sprite data per sprite:
+	const size_t VERTICES_PER_SPRITE = 6; //(a quad, plus a repeated first and last vertex to join the strip -- or two triangles, pulled)
+	size_t sprite_size = (instanced ? sizeof(SpriteInstance) : pulled ? TEXELS_PER_RECORD * sizeof(glm::uvec4) : VERTICES_PER_SPRITE * (compact ? sizeof(CompactVertex) : sizeof(Vertex)));
 
 	//shader program:
 	GLuint program = 0;
@@ -111,154 +224,626 @@ int main(int argc, char **argv) {
 	GLuint program_Color = 0;
 	GLuint program_mvp = 0;
 	GLuint program_tex = 0;
-	{ //compile shader program:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
-			"#version 330\n"
-			"uniform mat4 mvp;\n"
-			"in vec4 Position;\n"
-			"in vec2 TexCoord;\n"
-			"in vec4 Color;\n"
-			"out vec2 texCoord;\n"
-			"out vec4 color;\n"
-			"void main() {\n"
-			"	gl_Position = mvp * Position;\n"
-			"	color = Color;\n"
-			"	texCoord = TexCoord;\n"
-			"}\n"
-		);
-
-		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
-			"#version 330\n"
-			"uniform sampler2D tex;\n"
-			"in vec4 color;\n"
-			"in vec2 texCoord;\n"
-			"out vec4 fragColor;\n"
-			"void main() {\n"
-			"	fragColor = texture(tex, texCoord) * color;\n"
-			"}\n"
-		);
-
-		program = link_program(fragment_shader, vertex_shader);
-
-		//look up attribute locations:
-		program_Position = glGetAttribLocation(program, "Position");
-		if (program_Position == -1U) throw std::runtime_error("no attribute named Position");
-		program_TexCoord = glGetAttribLocation(program, "TexCoord");
-		if (program_TexCoord == -1U) throw std::runtime_error("no attribute named TexCoord");
-		program_Color = glGetAttribLocation(program, "Color");
-		if (program_Color == -1U) throw std::runtime_error("no attribute named Color");
-
-		//look up uniform locations:
-		program_mvp = glGetUniformLocation(program, "mvp");
-		if (program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
-		program_tex = glGetUniformLocation(program, "tex");
-		if (program_tex == -1U) throw std::runtime_error("no uniform named tex");
-	}
+	GLuint program_palette = 0;
+	GLuint program_indexed = 0;
+	GLuint program_tiles = 0;
+
+	//the same, for compact vertices (same fragment shader):
+	GLuint compact_program = 0;
+	GLuint compact_program_Position = 0;
+	GLuint compact_program_TexCoord = 0;
+	GLuint compact_program_Layer = 0;
+	GLuint compact_program_Color = 0;
+	GLuint compact_program_mvp = 0;
+	GLuint compact_program_tex = 0;
+	GLuint compact_program_palette = 0;
+	GLuint compact_program_indexed = 0;
+	GLuint compact_program_tiles = 0;
+
+	//instanced sprite program (same fragment shader):
+	GLuint instanced_program = 0;
+	GLuint instanced_program_Corner = 0;
+	GLuint instanced_program_At = 0;
+	GLuint instanced_program_Angle = 0;
+	GLuint instanced_program_Layer = 0;
+	GLuint instanced_program_Rect = 0;
+	GLuint instanced_program_UVRect = 0;
+	GLuint instanced_program_Tint = 0;
+	GLuint instanced_program_mvp = 0;
+	GLuint instanced_program_tex = 0;
+	GLuint instanced_program_palette = 0;
+	GLuint instanced_program_indexed = 0;
+	GLuint instanced_program_tiles = 0;
+
+	//vertex-pulling sprite program (same fragment shader again):
+	GLuint pulled_program = 0;
+	GLuint pulled_program_records = 0;
+	GLuint pulled_program_first_record = 0;
+	GLuint pulled_program_mvp = 0;
+	GLuint pulled_program_tex = 0;
+	GLuint pulled_program_palette = 0;
+	GLuint pulled_program_indexed = 0;
+	GLuint pulled_program_tiles = 0;
+
+	//vertex buffer -- one region per frame in flight, sized for the most sprites a frame draws:
+	const size_t MAX_SPRITES = 256;
+	StreamBuffer vertex_stream;
+
+	//background buffer -- the path tiles of visited cells. A cell's tile only changes when the cell is first
+	// visited, so the tiles are kept here (patched as cells are visited) rather than rebuilt every frame:
+	GLuint background_buffer = 0;
+	size_t background_count = 0; //sprites in it
+
+	//vertex array objects (for Vertex and CompactVertex):
+	GLuint vao = 0;
+	GLuint compact_vao = 0;
 
-	//vertex buffer:
-	GLuint buffer = 0;
-	{ //create vertex buffer
-		glGenBuffers(1, &buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	}
+	//the instanced renderer's quad -- corners (0,0), (0,1), (1,0), (1,1), as a strip -- and its vao:
+	GLuint quad_buffer = 0;
+	GLuint instanced_vao = 0;
 
-	struct Vertex {
-		Vertex(glm::vec2 const &Position_, glm::vec2 const &TexCoord_, glm::u8vec4 const &Color_) :
-			Position(Position_), TexCoord(TexCoord_), Color(Color_) { }
-		glm::vec2 Position;
-		glm::vec2 TexCoord;
-		glm::u8vec4 Color;
-	};
-	static_assert(sizeof(Vertex) == 20, "Vertex is nicely packed.");
+	//the pulled renderer's views of the stream and background buffers, and its (attribute-less) vao:
+	GLuint stream_records_tex = 0;
+	GLuint background_records_tex = 0;
+	GLuint pulled_vao = 0;
 
-	//vertex array object:
-	GLuint vao = 0;
-	{ //create vao and set up binding:
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
-		glVertexAttribPointer(program_Position, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0);
-		glVertexAttribPointer(program_TexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + sizeof(glm::vec2));
-		glVertexAttribPointer(program_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + sizeof(glm::vec2) + sizeof(glm::vec2));
-		glEnableVertexAttribArray(program_Position);
-		glEnableVertexAttribArray(program_TexCoord);
-		glEnableVertexAttribArray(program_Color);
-	}
+	//(the shader sources are compiled in, so there's nothing to load -- compiling just waits for the first frame)
+	loader.add("shaders", nullptr, [&]() {
+		if (config.sprite_renderer != "strip" && !instanced && !pulled) {
+			std::cerr << "Unknown sprite renderer '" << config.sprite_renderer << "' (expected \"strip\", \"instanced\", or \"pulled\")." << std::endl;
+			exit(1);
+		}
+		{ //compile shader program:
+			GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
+				"#version 330\n"
+				"uniform mat4 mvp;\n"
+				"in vec4 Position;\n"
+				"in vec3 TexCoord;\n"
+				"in vec4 Color;\n"
+				"out vec3 texCoord;\n"
+				"out vec4 color;\n"
+				"void main() {\n"
+				"	gl_Position = mvp * Position;\n"
+				"	color = Color;\n"
+				"	texCoord = TexCoord;\n"
+				"}\n"
+			);
+
+			GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
+				"#version 330\n"
+				"uniform sampler2D tex;\n"
+				"uniform sampler2D palette;\n"
+				"uniform bool indexed;\n" //tex holds indices into palette
+				"uniform sampler2DArray tiles;\n"
+				"in vec4 color;\n"
+				"in vec3 texCoord;\n"
+				"out vec4 fragColor;\n"
+				"void main() {\n"
+				//(the layer is the same all over a sprite, so neighboring fragments take the same branch)
+				"	vec4 texel;\n"
+				"	if (texCoord.z < 0.0) {\n"
+				"		texel = texture(tex, texCoord.xy);\n"
+				"		if (indexed) texel = texelFetch(palette, ivec2(int(texel.r * 255.0 + 0.5), 0), 0);\n"
+				"	} else {\n"
+				"		texel = texture(tiles, texCoord);\n"
+				"	}\n"
+				"	fragColor = texel * color;\n"
+				"}\n"
+			);
+
+			program = link_program(fragment_shader, vertex_shader);
+
+			//look up attribute locations:
+			program_Position = glGetAttribLocation(program, "Position");
+			if (program_Position == -1U) throw std::runtime_error("no attribute named Position");
+			program_TexCoord = glGetAttribLocation(program, "TexCoord");
+			if (program_TexCoord == -1U) throw std::runtime_error("no attribute named TexCoord");
+			program_Color = glGetAttribLocation(program, "Color");
+			if (program_Color == -1U) throw std::runtime_error("no attribute named Color");
+
+			//look up uniform locations:
+			program_mvp = glGetUniformLocation(program, "mvp");
+			if (program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
+			program_tex = glGetUniformLocation(program, "tex");
+			if (program_tex == -1U) throw std::runtime_error("no uniform named tex");
+			program_palette = glGetUniformLocation(program, "palette");
+			if (program_palette == -1U) throw std::runtime_error("no uniform named palette");
+			program_indexed = glGetUniformLocation(program, "indexed");
+			if (program_indexed == -1U) throw std::runtime_error("no uniform named indexed");
+			program_tiles = glGetUniformLocation(program, "tiles");
+			if (program_tiles == -1U) throw std::runtime_error("no uniform named tiles");
+
+			//compact version -- the attributes arrive normalized, so only the layer and tint need unpacking:
+			GLuint compact_vertex_shader = compile_shader(GL_VERTEX_SHADER,
+				"#version 330\n"
+				"uniform mat4 mvp;\n"
+				"in vec4 Position;\n"
+				"in vec2 TexCoord;\n"
+				"in float Layer;\n" //(255 for the atlas)
+				"in vec3 Color;\n"
+				"out vec3 texCoord;\n"
+				"out vec4 color;\n"
+				"void main() {\n"
+				"	gl_Position = mvp * Position;\n"
+				"	color = vec4(Color, 1.0);\n"
+				"	texCoord = vec3(TexCoord, (Layer == 255.0 ? -1.0 : Layer));\n"
+				"}\n"
+			);
+
+			compact_program = link_program(fragment_shader, compact_vertex_shader);
+
+			//look up attribute locations:
+			compact_program_Position = glGetAttribLocation(compact_program, "Position");
+			if (compact_program_Position == -1U) throw std::runtime_error("no attribute named Position");
+			compact_program_TexCoord = glGetAttribLocation(compact_program, "TexCoord");
+			if (compact_program_TexCoord == -1U) throw std::runtime_error("no attribute named TexCoord");
+			compact_program_Layer = glGetAttribLocation(compact_program, "Layer");
+			if (compact_program_Layer == -1U) throw std::runtime_error("no attribute named Layer");
+			compact_program_Color = glGetAttribLocation(compact_program, "Color");
+			if (compact_program_Color == -1U) throw std::runtime_error("no attribute named Color");
+
+			//look up uniform locations:
+			compact_program_mvp = glGetUniformLocation(compact_program, "mvp");
+			if (compact_program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
+			compact_program_tex = glGetUniformLocation(compact_program, "tex");
+			if (compact_program_tex == -1U) throw std::runtime_error("no uniform named tex");
+			compact_program_palette = glGetUniformLocation(compact_program, "palette");
+			if (compact_program_palette == -1U) throw std::runtime_error("no uniform named palette");
+			compact_program_indexed = glGetUniformLocation(compact_program, "indexed");
+			if (compact_program_indexed == -1U) throw std::runtime_error("no uniform named indexed");
+			compact_program_tiles = glGetUniformLocation(compact_program, "tiles");
+			if (compact_program_tiles == -1U) throw std::runtime_error("no uniform named tiles");
+
+			//instanced version -- each sprite's corners are made here, from its record:
+			GLuint instanced_vertex_shader = compile_shader(GL_VERTEX_SHADER,
+				"#version 330\n"
+				"uniform mat4 mvp;\n"
+				"in vec2 Corner;\n" //of the unit quad
+				"in vec2 At;\n"
+				"in float Angle;\n"
+				"in float Layer;\n"
+				"in vec4 Rect;\n"
+				"in vec4 UVRect;\n"
+				"in vec4 Tint;\n"
+				"out vec3 texCoord;\n"
+				"out vec4 color;\n"
+				"void main() {\n"
+				"	vec2 right = vec2(cos(Angle), sin(Angle));\n"
+				"	vec2 up = vec2(-right.y, right.x);\n"
+				"	vec2 corner = mix(Rect.xy, Rect.zw, Corner);\n"
+				"	gl_Position = mvp * vec4(At + right * corner.x + up * corner.y, 0.0, 1.0);\n"
+				"	color = Tint;\n"
+				"	texCoord = vec3(mix(UVRect.xy, UVRect.zw, Corner), Layer);\n"
+				"}\n"
+			);
+
+			instanced_program = link_program(fragment_shader, instanced_vertex_shader);
+
+			//look up attribute locations:
+			instanced_program_Corner = glGetAttribLocation(instanced_program, "Corner");
+			if (instanced_program_Corner == -1U) throw std::runtime_error("no attribute named Corner");
+			instanced_program_At = glGetAttribLocation(instanced_program, "At");
+			if (instanced_program_At == -1U) throw std::runtime_error("no attribute named At");
+			instanced_program_Angle = glGetAttribLocation(instanced_program, "Angle");
+			if (instanced_program_Angle == -1U) throw std::runtime_error("no attribute named Angle");
+			instanced_program_Layer = glGetAttribLocation(instanced_program, "Layer");
+			if (instanced_program_Layer == -1U) throw std::runtime_error("no attribute named Layer");
+			instanced_program_Rect = glGetAttribLocation(instanced_program, "Rect");
+			if (instanced_program_Rect == -1U) throw std::runtime_error("no attribute named Rect");
+			instanced_program_UVRect = glGetAttribLocation(instanced_program, "UVRect");
+			if (instanced_program_UVRect == -1U) throw std::runtime_error("no attribute named UVRect");
+			instanced_program_Tint = glGetAttribLocation(instanced_program, "Tint");
+			if (instanced_program_Tint == -1U) throw std::runtime_error("no attribute named Tint");
+
+			//look up uniform locations:
+			instanced_program_mvp = glGetUniformLocation(instanced_program, "mvp");
+			if (instanced_program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
+			instanced_program_tex = glGetUniformLocation(instanced_program, "tex");
+			if (instanced_program_tex == -1U) throw std::runtime_error("no uniform named tex");
+			instanced_program_palette = glGetUniformLocation(instanced_program, "palette");
+			if (instanced_program_palette == -1U) throw std::runtime_error("no uniform named palette");
+			instanced_program_indexed = glGetUniformLocation(instanced_program, "indexed");
+			if (instanced_program_indexed == -1U) throw std::runtime_error("no uniform named indexed");
+			instanced_program_tiles = glGetUniformLocation(instanced_program, "tiles");
+			if (instanced_program_tiles == -1U) throw std::runtime_error("no uniform named tiles");
+
+			//pulled version -- no attributes at all; vertex 'gl_VertexID % 6' of record 'gl_VertexID / 6' is made from
+			// texels fetched out of 'records' (layout as SpriteInstance, so the floats come back as bits):
+			GLuint pulled_vertex_shader = compile_shader(GL_VERTEX_SHADER,
+				"#version 330\n"
+				"uniform mat4 mvp;\n"
+				"uniform usamplerBuffer records;\n"
+				"uniform int first_record;\n"
+				"out vec3 texCoord;\n"
+				"out vec4 color;\n"
+				"void main() {\n"
+				"	int texel = 3 * (first_record + gl_VertexID / 6);\n"
+				"	uvec4 a = texelFetch(records, texel);\n" //At, Angle, Layer
+				"	vec4 Rect = uintBitsToFloat(texelFetch(records, texel + 1));\n"
+				"	uvec4 c = texelFetch(records, texel + 2);\n" //UVRect (two u16 per uint), Tint (four u8)
+				"	vec4 UVRect = vec4(c.x & 0xffffu, c.x >> 16, c.y & 0xffffu, c.y >> 16) / 65535.0;\n"
+				"	vec4 Tint = vec4(c.z & 0xffu, (c.z >> 8) & 0xffu, (c.z >> 16) & 0xffu, c.z >> 24) / 255.0;\n"
+				//corners of the two triangles -- (0,0) (0,1) (1,0), (1,0) (0,1) (1,1) -- the same split as the strip:
+				"	int v = gl_VertexID % 6;\n"
+				"	vec2 Corner = vec2(v == 2 || v == 3 || v == 5, v == 1 || v == 4 || v == 5);\n"
+				"	vec2 At = uintBitsToFloat(a.xy);\n"
+				"	float Angle = uintBitsToFloat(a.z);\n"
+				"	vec2 right = vec2(cos(Angle), sin(Angle));\n"
+				"	vec2 up = vec2(-right.y, right.x);\n"
+				"	vec2 corner = mix(Rect.xy, Rect.zw, Corner);\n"
+				"	gl_Position = mvp * vec4(At + right * corner.x + up * corner.y, 0.0, 1.0);\n"
+				"	color = Tint;\n"
+				"	texCoord = vec3(mix(UVRect.xy, UVRect.zw, Corner), uintBitsToFloat(a.w));\n"
+				"}\n"
+			);
+
+			pulled_program = link_program(fragment_shader, pulled_vertex_shader);
+
+			//look up uniform locations:
+			pulled_program_records = glGetUniformLocation(pulled_program, "records");
+			if (pulled_program_records == -1U) throw std::runtime_error("no uniform named records");
+			pulled_program_first_record = glGetUniformLocation(pulled_program, "first_record");
+			if (pulled_program_first_record == -1U) throw std::runtime_error("no uniform named first_record");
+			pulled_program_mvp = glGetUniformLocation(pulled_program, "mvp");
+			if (pulled_program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
+			pulled_program_tex = glGetUniformLocation(pulled_program, "tex");
+			if (pulled_program_tex == -1U) throw std::runtime_error("no uniform named tex");
+			pulled_program_palette = glGetUniformLocation(pulled_program, "palette");
+			if (pulled_program_palette == -1U) throw std::runtime_error("no uniform named palette");
+			pulled_program_indexed = glGetUniformLocation(pulled_program, "indexed");
+			if (pulled_program_indexed == -1U) throw std::runtime_error("no uniform named indexed");
+			pulled_program_tiles = glGetUniformLocation(pulled_program, "tiles");
+			if (pulled_program_tiles == -1U) throw std::runtime_error("no uniform named tiles");
+		}
+
+		{ //create vertex buffer
+			PFNGLBUFFERSTORAGEPROC buffer_storage = nullptr;
+			if (config.persistent_buffers && has_gl_extension("GL_ARB_buffer_storage")) {
+				buffer_storage = reinterpret_cast< PFNGLBUFFERSTORAGEPROC >(SDL_GL_GetProcAddress("glBufferStorage"));
+			}
+			vertex_stream.create(GL_ARRAY_BUFFER, MAX_SPRITES * sprite_size, 3, buffer_storage);
+
+			glGenBuffers(1, &background_buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, background_buffer);
+			glBufferData(GL_ARRAY_BUFFER, MAX_SPRITES * sprite_size, nullptr, GL_DYNAMIC_DRAW);
+		}
+
+		{ //create vaos (their attributes are pointed at sprite data -- streamed or background -- when drawing):
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+			glEnableVertexAttribArray(program_Position);
+			glEnableVertexAttribArray(program_TexCoord);
+			glEnableVertexAttribArray(program_Color);
+
+			glGenVertexArrays(1, &compact_vao);
+			glBindVertexArray(compact_vao);
+			glEnableVertexAttribArray(compact_program_Position);
+			glEnableVertexAttribArray(compact_program_TexCoord);
+			glEnableVertexAttribArray(compact_program_Layer);
+			glEnableVertexAttribArray(compact_program_Color);
+		}
+
+		{ //create the unit quad and the instanced vao:
+			const glm::u8vec2 corners[4] = {
+				glm::u8vec2(0, 0), glm::u8vec2(0, 1), glm::u8vec2(1, 0), glm::u8vec2(1, 1)
+			};
+			glGenBuffers(1, &quad_buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+			glGenVertexArrays(1, &instanced_vao);
+			glBindVertexArray(instanced_vao);
+			glVertexAttribPointer(instanced_program_Corner, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(glm::u8vec2), (GLbyte *)0);
+			glEnableVertexAttribArray(instanced_program_Corner);
+			//(records are wherever each frame's (or the background's) are -- so those pointers are set when drawing)
+			for (GLuint attribute : {instanced_program_At, instanced_program_Angle, instanced_program_Layer, instanced_program_Rect, instanced_program_UVRect, instanced_program_Tint}) {
+				glVertexAttribDivisor(attribute, 1);
+				glEnableVertexAttribArray(attribute);
+			}
+		}
+
+		{ //create the buffer textures the pulled renderer reads records through, and its vao:
+			//(a buffer texture sees the whole buffer, so draws say which record to start at instead)
+			glGenTextures(1, &stream_records_tex);
+			glBindTexture(GL_TEXTURE_BUFFER, stream_records_tex);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, vertex_stream.buffer);
+
+			glGenTextures(1, &background_records_tex);
+			glBindTexture(GL_TEXTURE_BUFFER, background_records_tex);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, background_buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+			//(core profile still wants a vao bound to draw, even with no attributes)
+			glGenVertexArrays(1, &pulled_vao);
+		}
+	});
+
+	//texture:
+	GLuint tex = 0;
+	//palette for 'tex', if it holds palette indices (else 0):
+	GLuint palette_tex = 0;
+	glm::uvec2 tex_size = glm::uvec2(0,0);
+
+	TextureUpload tex_upload;
+	TextureReload tex_reload;
+
+	//what the texture's load hands to its finish (freed once the tiles have been cut out of it, too):
+	struct LoadedTexture {
+		MipTexture mips;
+		std::vector< uint8_t > unpacked; //(a compressed pack entry, unpacked -- build_pack stores .mips raw, so only for other packs)
+		glm::uvec2 indexed_size = glm::uvec2(0,0);
+		std::vector< uint8_t > indices;
+		std::vector< uint32_t > palette;
+		CachedImage image;
+		//the RGBA levels above, block-compressed by the load (if compressing), so the finish only uploads:
+		BlockFormat block_format = BlockBC1;
+		std::vector< std::vector< uint8_t > > blocks;
+	};
+	std::unique_ptr< LoadedTexture > loaded_tex;
+
+	//(asked here, on the GL thread, so the texture's load can do the compressing; hot reload re-uploads
+	// plain RGBA8 rectangles, so it needs an uncompressed texture)
+	bool compress_blocks = config.compress_textures && config.hot_reload.empty() && has_gl_extension("GL_EXT_texture_compression_s3tc");
+
+	//texels are premultiplied at load time to match the blend function used for drawing:
+	loader.add("texture '" + config.textures + "'", [&]() {
+		loaded_tex.reset(new LoadedTexture);
+		LoadedTexture &loaded = *loaded_tex;
+		if (config.indexed_textures) {
+			if (is_mips(config.textures)) {
+				std::cerr << "indexed_textures needs a palette .png, not '" << config.textures << "'." << std::endl;
+				return false;
+			}
+			if (!load_png_indexed(config.textures, &loaded.indexed_size.x, &loaded.indexed_size.y, &loaded.indices, &loaded.palette, LowerLeftOrigin, PremultipliedAlpha)) {
+				return false;
+			}
+			//(unused entries transparent)
+			loaded.palette.resize(256, 0);
+			return true;
+		} else if (is_mips(config.textures)) {
+			PackEntry const *entry = pack.find(config.textures);
+			AssetSpan span;
+			if (entry ? !(pack.get(*entry, &span, &loaded.unpacked) && load_mip_texture(span.data, span.size, &loaded.mips)) : !load_mip_texture(config.textures, &loaded.mips)) {
+				return false;
+			}
+			if (loaded.mips.origin != LowerLeftOrigin || loaded.mips.alpha != PremultipliedAlpha) {
+				std::cerr << "Texture '" << config.textures << "' wasn't built bottom-row-first and premultiplied." << std::endl;
+				return false;
+			}
+			if (compress_blocks) {
+				MipTexture const &mips = loaded.mips;
+				//(every level has to share one format for the texture to be complete -- and filtering makes partial
+				// alpha in the smaller levels even when level 0 has none -- so BC3 if any level needs it)
+				for (unsigned int l = 0; l < mips.levels && loaded.block_format == BlockBC1; ++l) {
+					loaded.block_format = choose_block_format(mips.level_width(l), mips.level_height(l), mips.level(l));
+				}
+				loaded.blocks.resize(mips.levels);
+				for (unsigned int l = 0; l < mips.levels; ++l) {
+					loaded.blocks[l].resize(block_compressed_size(mips.level_width(l), mips.level_height(l), loaded.block_format));
+					block_compress(mips.level_width(l), mips.level_height(l), mips.level(l), loaded.block_format, loaded.blocks[l].data());
+				}
+			}
+			return true;
+		} else if (config.async_upload && !is_qoi(config.textures)) {
+			//(tex_upload decodes on a worker of its own, straight into GL memory)
+			return true;
+		} else {
+			CachedImage &image = loaded.image;
+			if (!load_image(config.textures, &image, LowerLeftOrigin, PremultipliedAlpha)) {
+				return false;
+			}
+			if (compress_blocks && image.channels == 4) {
+				uint32_t const *pixels = reinterpret_cast< uint32_t const * >(image.data);
+				loaded.block_format = choose_block_format(image.width, image.height, pixels);
+				loaded.blocks.resize(1);
+				loaded.blocks[0].resize(block_compressed_size(image.width, image.height, loaded.block_format));
+				block_compress(image.width, image.height, pixels, loaded.block_format, loaded.blocks[0].data());
+			}
+			return true;
+		}
+	}, [&]() {
+		LoadedTexture &loaded = *loaded_tex;
+		//create a texture object:
+		glGenTextures(1, &tex);
+		//levels above 0, if the texture comes with any:
+		unsigned int tex_mip_levels = 0;
+		if (config.indexed_textures) {
+			tex_size = loaded.indexed_size;
+			glBindTexture(GL_TEXTURE_2D, tex);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, tex_size.x, tex_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, loaded.indices.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+			//palette as a 256x1 texture, read with texelFetch:
+			glGenTextures(1, &palette_tex);
+			glBindTexture(GL_TEXTURE_2D, palette_tex);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, loaded.palette.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		} else if (is_mips(config.textures)) {
+			MipTexture const &mips = loaded.mips;
+			tex_size = glm::uvec2(mips.width, mips.height);
+			//every level comes straight out of the one mapping (or the pack):
+			glBindTexture(GL_TEXTURE_2D, tex);
+			for (unsigned int l = 0; l < mips.levels; ++l) {
+				upload_rgba_level(l, mips.level_width(l), mips.level_height(l), mips.level(l), (loaded.blocks.empty() ? nullptr : &loaded.blocks[l]), loaded.block_format);
+			}
+			tex_mip_levels = mips.levels - 1;
+			if (!config.hot_reload.empty()) {
+				tex_reload.watch(config.hot_reload, tex, mips.width, mips.height, mips.levels, mips.level(0), mips.origin, mips.alpha);
+			}
+		} else if (config.async_upload && !is_qoi(config.textures)) {
+			if (!tex_upload.start(config.textures, tex, LowerLeftOrigin, PremultipliedAlpha)) {
+				std::cerr << "Failed to load texture." << std::endl;
+				exit(1);
+			}
+			tex_size = glm::uvec2(tex_upload.width, tex_upload.height);
+		} else {
+			CachedImage const &image = loaded.image;
+			tex_size = glm::uvec2(image.width, image.height);
+			//upload texture data from data (at 1, 2 or 4 bytes per texel, as decoded):
+			glBindTexture(GL_TEXTURE_2D, tex);
+			if (image.channels == 4) {
+				uint32_t const *pixels = reinterpret_cast< uint32_t const * >(image.data);
+				upload_rgba_level(0, image.width, image.height, pixels, (loaded.blocks.empty() ? nullptr : &loaded.blocks[0]), loaded.block_format);
+				if (!config.hot_reload.empty()) {
+					tex_reload.watch(config.hot_reload, tex, image.width, image.height, 1, pixels, LowerLeftOrigin, PremultipliedAlpha);
+				}
+			} else {
+				tex_image_2d(image.width, image.height, image.channels, image.data);
+			}
+		}
+		//bind texture object to GL_TEXTURE_2D:
+		glBindTexture(GL_TEXTURE_2D, tex);
+		//set texture sampling parameters:
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		//(the mip chain ends where sprite cells reach one texel, so clamp sampling to the levels that exist;
+		// nearest texel within a level keeps every lookup inside the sprite's own cell)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex_mip_levels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tex_mip_levels ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	});
 
 	//------------ sprite info ------------
 	struct SpriteInfo {
 		glm::vec2 min_uv = glm::vec2(0.0f);
 		glm::vec2 max_uv = glm::vec2(1.0f);
-		glm::vec2 rad = glm::vec2(1.0f);
-	} grid00, grid01, grid10, grid11, grid20, grid21, grid30, grid31, grid40, grid41, 
+		//corners of the quad, relative to where the sprite is drawn (before rotation):
+		glm::vec2 min = glm::vec2(-1.0f);
+		glm::vec2 max = glm::vec2(1.0f);
+		//layer of the tile array the uvs are in, or -1 for the atlas:
+		float layer = -1.0f;
+	} grid00, grid01, grid10, grid11, grid20, grid21, grid30, grid31, grid40, grid41,
 		rock, player, treasure, text[4];
 
-	grid00.min_uv = glm::vec2(0.0f, 0.83333f);
-	grid00.max_uv = glm::vec2(0.2f, 1.0f);
-	grid00.rad = glm::vec2(0.2f, 0.14286f);
-
-	grid01.min_uv = glm::vec2(0.0f, 0.83333f);
-	grid01.max_uv = glm::vec2(0.2f, 1.0f);
-	grid01.rad = glm::vec2(0.14286f, 0.2f);
-
-	grid10.min_uv = glm::vec2(0.2f, 0.83333f);
-	grid10.max_uv = glm::vec2(0.4f, 1.0f);
-	grid10.rad = glm::vec2(0.2f, 0.14286f);
-
-	grid11.min_uv = glm::vec2(0.2f, 0.83333f);
-	grid11.max_uv = glm::vec2(0.4f, 1.0f);
-	grid11.rad = glm::vec2(0.14286f, 0.2f);
-
-	grid20.min_uv = glm::vec2(0.4f, 0.83333f);
-	grid20.max_uv = glm::vec2(0.6f, 1.0f);
-	grid20.rad = glm::vec2(0.2f, 0.14286f);
-
-	grid21.min_uv = glm::vec2(0.4f, 0.83333f);
-	grid21.max_uv = glm::vec2(0.6f, 1.0f);
-	grid21.rad = glm::vec2(0.14286f, 0.2f);
-
-	grid30.min_uv = glm::vec2(0.6f, 0.83333f);
-	grid30.max_uv = glm::vec2(0.8f, 1.0f);
-	grid30.rad = glm::vec2(0.2f, 0.14286f);
-
-	grid31.min_uv = glm::vec2(0.6f, 0.83333f);
-	grid31.max_uv = glm::vec2(0.8f, 1.0f);
-	grid31.rad = glm::vec2(0.14286f, 0.2f);
-
-	grid40.min_uv = glm::vec2(0.8f, 0.83333f);
-	grid40.max_uv = glm::vec2(1.0f, 1.0f);
-	grid40.rad = glm::vec2(0.2f, 0.14286f);
-
-	grid41.min_uv = glm::vec2(0.8f, 0.83333f);
-	grid41.max_uv = glm::vec2(1.0f, 1.0f);
-	grid41.rad = glm::vec2(0.14286f, 0.2f);
-
-	rock.min_uv = glm::vec2(0.0f, 0.66667f);
-	rock.max_uv = glm::vec2(0.2f, 0.83333f);
-	rock.rad = glm::vec2(0.2f, 0.14286f);
-
-	player.min_uv = glm::vec2(0.2f, 0.66667f);
-	player.max_uv = glm::vec2(0.4f, 0.83333f);
-	player.rad = glm::vec2(0.2f, 0.14286f);
-	
-	treasure.min_uv = glm::vec2(0.4f, 0.66667f);
-	treasure.max_uv = glm::vec2(0.6f, 0.83333f);
-	treasure.rad = glm::vec2(0.2f, 0.14286f);
-	
-	text[0].min_uv = glm::vec2(0.0f, 0.5f);
-	text[0].max_uv = glm::vec2(1.0f, 0.66667f);
-	text[0].rad = glm::vec2(1.0f, 0.14286f);
-
-	text[1].min_uv = glm::vec2(0.0f, 0.33333f);
-	text[1].max_uv = glm::vec2(1.0f, 0.5f);
-	text[1].rad = glm::vec2(1.0f, 0.14286f);
-
-	text[2].min_uv = glm::vec2(0.0f, 0.16667f);
-	text[2].max_uv = glm::vec2(1.0f, 0.33333f);
-	text[2].rad = glm::vec2(1.0f, 0.14286f);
-
-	text[3].min_uv = glm::vec2(0.0f, 0.0f);
-	text[3].max_uv = glm::vec2(1.0f, 0.16667f);
-	text[3].rad = glm::vec2(1.0f, 0.14286f);
+	//tile array -- one layer per tile, each with its own mip chain (0 if tiles are drawn from the atlas):
+	GLuint tiles_tex = 0;
+	//layers, from the sprite table's load to its finish (bottom row first, like the atlas):
+	glm::uvec2 tile_size = glm::uvec2(0,0);
+	std::vector< uint32_t > tile_layers;
+
+	//look sprites up in the table pack_atlas wrote alongside the atlas:
+	SpriteTable table;
+	loader.add("sprite table '" + config.sprites + "'", [&]() {
+		PackEntry const *entry = pack.find(config.sprites);
+		AssetSpan span;
+		std::vector< uint8_t > unpacked;
+		if (entry ? !(pack.get(*entry, &span, &unpacked) && load_sprite_table(span.data, span.size, &table)) : !load_sprite_table(config.sprites, &table)) {
+			return false;
+		}
+
+		//cut the tiles out of the atlas, if its level 0 is on hand as RGBA:
+		LoadedTexture const &loaded = *loaded_tex;
+		uint32_t const *atlas = nullptr;
+		glm::uvec2 atlas_size = glm::uvec2(0,0);
+		if (loaded.mips.levels) {
+			atlas = loaded.mips.level(0);
+			atlas_size = glm::uvec2(loaded.mips.width, loaded.mips.height);
+		} else if (loaded.image.channels == 4) {
+			atlas = reinterpret_cast< uint32_t const * >(loaded.image.data);
+			atlas_size = glm::uvec2(loaded.image.width, loaded.image.height);
+		}
+		//(a mismatched table is reported by the finish)
+		if (!config.tile_array || !config.hot_reload.empty() || !atlas || atlas_size != glm::uvec2(table.width, table.height)) {
+			return true;
+		}
+		for (auto const &name : tile_names) {
+			Sprite const *sprite = table.find(name);
+			if (!sprite) continue;
+			glm::uvec2 size = glm::uvec2(sprite->source_width, sprite->source_height);
+			if (tile_size == glm::uvec2(0,0)) tile_size = size;
+			if (size != tile_size) {
+				std::cerr << "Tile '" << name << "' is " << size.x << "x" << size.y << ", but the tiles before it are " << tile_size.x << "x" << tile_size.y << "." << std::endl;
+				return false;
+			}
+		}
+		tile_layers.assign(size_t(tile_size.x) * tile_size.y * tile_names.size(), 0);
+		for (size_t t = 0; t < tile_names.size(); ++t) {
+			Sprite const *sprite = table.find(tile_names[t]);
+			if (!sprite) continue;
+			//the trimmed texels go back where they were in the untrimmed tile, with clear texels around them:
+			uint32_t *layer = &tile_layers[size_t(tile_size.x) * tile_size.y * t];
+			for (unsigned int y = 0; y < sprite->h; ++y) {
+				//(table rows count from the top)
+				uint32_t const *from = atlas + size_t(table.height - 1 - (sprite->y + y)) * table.width + sprite->x;
+				uint32_t *to = layer + size_t(tile_size.y - 1 - (sprite->trim_y + y)) * tile_size.x + sprite->trim_x;
+				std::copy(from, from + sprite->w, to);
+			}
+		}
+		return true;
+	}, [&]() {
+		if (tex_size != glm::uvec2(table.width, table.height)) {
+			std::cerr << "Sprite table '" << config.sprites << "' is for a " << table.width << "x" << table.height << " atlas, but the texture is " << tex_size.x << "x" << tex_size.y << "." << std::endl;
+			exit(1);
+		}
+		loaded_tex.reset();
+
+		if (!tile_layers.empty()) {
+			glGenTextures(1, &tiles_tex);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, tiles_tex);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, tile_size.x, tile_size.y, GLsizei(tile_names.size()), 0, GL_RGBA, GL_UNSIGNED_BYTE, tile_layers.data());
+			//(texels are premultiplied, so a plain box filter is fine -- and no layer sees another's texels)
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			tile_layers.clear();
+			tile_layers.shrink_to_fit();
+		}
+		//world units per atlas texel (the art was drawn at 32 texels per cell of the 5x7 grid):
+		const glm::vec2 texel = glm::vec2(2.0f / (5.0f * 32.0f), 2.0f / (7.0f * 32.0f));
+		//'turned' sprites are drawn rotated a quarter turn, so they scale along swapped axes:
+		auto sprite_info = [&](std::string const &name, bool turned) {
+			Sprite const *sprite = table.find(name);
+			if (!sprite) {
+				std::cerr << "Sprite table '" << config.sprites << "' has no sprite named '" << name << "'." << std::endl;
+				exit(1);
+			}
+			SpriteInfo info;
+			auto tile = std::find(tile_names.begin(), tile_names.end(), name);
+			if (tiles_tex && tile != tile_names.end()) {
+				//the trimmed rect within the tile's own layer:
+				info.layer = float(tile - tile_names.begin());
+				info.min_uv = glm::vec2(sprite->trim_x, tile_size.y - (sprite->trim_y + sprite->h)) / glm::vec2(tile_size);
+				info.max_uv = glm::vec2(sprite->trim_x + sprite->w, tile_size.y - sprite->trim_y) / glm::vec2(tile_size);
+			} else {
+				//(the table is upper-left origin; the texture was uploaded bottom row first)
+				info.min_uv = glm::vec2(sprite->x, table.height - (sprite->y + sprite->h)) / glm::vec2(tex_size);
+				info.max_uv = glm::vec2(sprite->x + sprite->w, table.height - sprite->y) / glm::vec2(tex_size);
+			}
+			//trimmed rect relative to the center of the untrimmed sprite, y up:
+			glm::vec2 half = 0.5f * glm::vec2(sprite->source_width, sprite->source_height);
+			glm::vec2 scale = (turned ? glm::vec2(texel.y, texel.x) : texel);
+			info.min = scale * glm::vec2(sprite->trim_x - half.x, half.y - (sprite->trim_y + sprite->h));
+			info.max = scale * glm::vec2(sprite->trim_x + sprite->w - half.x, half.y - sprite->trim_y);
+			return info;
+		};
+
+		grid00 = sprite_info("grid0", false);
+		grid01 = sprite_info("grid0", true);
+		grid10 = sprite_info("grid1", false);
+		grid11 = sprite_info("grid1", true);
+		grid20 = sprite_info("grid2", false);
+		grid21 = sprite_info("grid2", true);
+		grid30 = sprite_info("grid3", false);
+		grid31 = sprite_info("grid3", true);
+		grid40 = sprite_info("grid4", false);
+		grid41 = sprite_info("grid4", true);
+
+		rock = sprite_info("rock", false);
+		player = sprite_info("player", false);
+		treasure = sprite_info("treasure", false);
+
+		for (unsigned int i = 0; i < 4; ++i) {
+			text[i] = sprite_info("text" + std::to_string(i), false);
+		}
+	});
+
+	loader.start();
 
 	//------------ pathing info ----------
 
@@ -389,6 +974,56 @@ int main(int argc, char **argv) {
 	bool rocks_mined[5] = {};
 	int current_cell = 12;
 
+	//path tile drawn in each cell once it has been visited (turned by some number of quarter turns;
+	// cells are numbered row by row from the top left, five to a row):
+	struct CellTile {
+		SpriteInfo const *sprite;
+		glm::vec2 at;
+		float turns;
+	};
+	const CellTile cell_tiles[30] = {
+		{&grid00, glm::vec2(-0.8f, 0.85714f), 0.0f},
+		{&grid31, glm::vec2(-0.4f, 0.85714f), 1.0f},
+		{&grid31, glm::vec2(0.0f, 0.85714f), 1.0f},
+		{&grid21, glm::vec2(0.4f, 0.85714f), 1.0f},
+		{&grid01, glm::vec2(0.8f, 0.85714f), 3.0f},
+
+		{&grid01, glm::vec2(-0.8f, 0.57143f), 3.0f},
+		{&grid01, glm::vec2(-0.4f, 0.57143f), 1.0f},
+		{&grid30, glm::vec2(0.0f, 0.57143f), 2.0f},
+		{&grid30, glm::vec2(0.4f, 0.57143f), 0.0f},
+		{&grid10, glm::vec2(0.8f, 0.57143f), 0.0f},
+
+		{&grid21, glm::vec2(-0.8f, 0.28571f), 3.0f},
+		{&grid11, glm::vec2(-0.4f, 0.28571f), 1.0f},
+		{&grid30, glm::vec2(0.0f, 0.28571f), 0.0f},
+		{&grid21, glm::vec2(0.4f, 0.28571f), 3.0f},
+		{&grid20, glm::vec2(0.8f, 0.28571f), 0.0f},
+
+		{&grid01, glm::vec2(-0.8f, 0.0f), 3.0f},
+		{&grid20, glm::vec2(-0.4f, 0.0f), 2.0f},
+		{&grid31, glm::vec2(0.0f, 0.0f), 3.0f},
+		{&grid31, glm::vec2(0.4f, 0.0f), 1.0f},
+		{&grid21, glm::vec2(0.8f, 0.0f), 1.0f},
+
+		{&grid10, glm::vec2(-0.8f, -0.28571f), 0.0f},
+		{&grid10, glm::vec2(-0.4f, -0.28571f), 0.0f},
+		{&grid01, glm::vec2(0.0f, -0.28571f), 3.0f},
+		{&grid10, glm::vec2(0.4f, -0.28571f), 0.0f},
+		{&grid01, glm::vec2(0.8f, -0.28571f), 1.0f},
+
+		{&grid21, glm::vec2(-0.8f, -0.57143f), 3.0f},
+		{&grid31, glm::vec2(-0.4f, -0.57143f), 3.0f},
+		{&grid31, glm::vec2(0.0f, -0.57143f), 3.0f},
+		{&grid31, glm::vec2(0.4f, -0.57143f), 3.0f},
+		{&grid00, glm::vec2(0.8f, -0.57143f), 2.0f}
+	};
+	//background slot holding each cell's tile (-1 if it has none yet):
+	int background_slots[30];
+	std::fill(background_slots, background_slots + 30, -1);
+	//cells whose tile the background buffer doesn't show yet:
+	std::vector< int > dirty_cells;
+
 	//------------ game loop ------------
 
 	bool should_quit = false;
@@ -471,7 +1106,10 @@ int main(int argc, char **argv) {
 			int current_cell_x = (int)((player_pos.x + 1.0f)*2.5f);
 			current_cell = current_cell_y * 5 + current_cell_x;
 			
-			cells_visited[current_cell] = true;
+			if (!cells_visited[current_cell]) {
+				cells_visited[current_cell] = true;
+				dirty_cells.emplace_back(current_cell);
+			}
 			if (current_cell == 4) {
 				if (rocks_mined[0]) {
 					if (treasure_rock == 0) {
@@ -531,123 +1169,93 @@ int main(int argc, char **argv) {
 		glClearColor(0.0, 0.0, 0.0, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT);
 		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		//(texture is premultiplied, and so are sprite tints -- opaque white, currently)
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-		{ //draw game state:
-			std::vector< Vertex > verts;
+		//(assets -- and then the texture's pixels -- may still be on their way, in which case there's nothing to draw with yet)
+		bool assets_ready = loader.update();
+		if (loader.state == AssetLoader::Failed) {
+			//(the loader has already said which asset)
+			exit(1);
+		}
+		bool tex_ready = assets_ready && (tex_upload.state == TextureUpload::Idle || tex_upload.update());
+		if (tex_upload.state == TextureUpload::Failed) {
+			std::cerr << "Failed to load texture." << std::endl;
+			exit(1);
+		}
+		//(picks up edits to the texture's source, if it's being watched)
+		if (unsigned int tiles = tex_reload.update()) {
+			std::cout << "Reloaded " << tiles << " " << tex_reload.tile_size << "x" << tex_reload.tile_size << " tile" << (tiles == 1 ? "" : "s") << " of '" << config.hot_reload << "'." << std::endl;
+		}
 
-			auto draw_sprite = [&verts](SpriteInfo const &sprite, glm::vec2 const &at, float angle = 0.0f) {
+		if (tex_ready) { //draw game state:
+			//one sprite's vertices (or record), sprite_size bytes at 'to':
+			auto write_sprite = [&](void *to, SpriteInfo const &sprite, glm::vec2 const &at, float angle) {
+				glm::u8vec4 tint = glm::u8vec4(0xff, 0xff, 0xff, 0xff);
+				if (instanced || pulled) {
+					new (to) SpriteInstance(at, angle, sprite.layer, glm::vec4(sprite.min, sprite.max), glm::vec4(sprite.min_uv, sprite.max_uv), tint);
+					return;
+				}
 				glm::vec2 min_uv = sprite.min_uv;
 				glm::vec2 max_uv = sprite.max_uv;
-				glm::vec2 rad = sprite.rad;
-				glm::u8vec4 tint = glm::u8vec4(0xff, 0xff, 0xff, 0xff);
+				glm::vec2 min = sprite.min;
+				glm::vec2 max = sprite.max;
+				float layer = sprite.layer;
 				glm::vec2 right = glm::vec2(std::cos(angle), std::sin(angle));
 				glm::vec2 up = glm::vec2(-right.y, right.x);
 
-				verts.emplace_back(at + right * -rad.x + up * -rad.y, glm::vec2(min_uv.x, min_uv.y), tint);
-				verts.emplace_back(verts.back());
-				verts.emplace_back(at + right * -rad.x + up * rad.y, glm::vec2(min_uv.x, max_uv.y), tint);
-				verts.emplace_back(at + right * rad.x + up * -rad.y, glm::vec2(max_uv.x, min_uv.y), tint);
-				verts.emplace_back(at + right * rad.x + up * rad.y, glm::vec2(max_uv.x, max_uv.y), tint);
-				verts.emplace_back(verts.back());
+				glm::vec2 positions[4] = {
+					at + right * min.x + up * min.y,
+					at + right * min.x + up * max.y,
+					at + right * max.x + up * min.y,
+					at + right * max.x + up * max.y,
+				};
+				glm::vec3 tex_coords[4] = {
+					glm::vec3(min_uv.x, min_uv.y, layer),
+					glm::vec3(min_uv.x, max_uv.y, layer),
+					glm::vec3(max_uv.x, min_uv.y, layer),
+					glm::vec3(max_uv.x, max_uv.y, layer),
+				};
+				//(the mapping is write-only, so the repeated vertices are built again rather than read back)
+				static const int corners[VERTICES_PER_SPRITE] = {0, 0, 1, 2, 3, 3};
+				for (size_t i = 0; i < VERTICES_PER_SPRITE; ++i) {
+					int c = corners[i];
+					if (compact) new (reinterpret_cast< CompactVertex * >(to) + i) CompactVertex(positions[c], tex_coords[c], tint);
+					else new (reinterpret_cast< Vertex * >(to) + i) Vertex(positions[c], tex_coords[c], tint);
+				}
 			};
 
-			if (cells_visited[0]) {
-				draw_sprite(grid00, glm::vec2(-0.8f, 0.85714f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[1]) {
-				draw_sprite(grid31, glm::vec2(-0.4f, 0.85714f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[2]) {
-				draw_sprite(grid31, glm::vec2(0.0f, 0.85714f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[3]) {
-				draw_sprite(grid21, glm::vec2(0.4f, 0.85714f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[4]) {
-				draw_sprite(grid01, glm::vec2(0.8f, 0.85714f), pi/2.0f * 3.0f);
-			}
+			//the rest of the sprites go straight into this frame's region of the stream buffer:
+			vertex_stream.begin_frame();
+			size_t sprites_offset = 0;
+			uint8_t *sprites = reinterpret_cast< uint8_t * >(vertex_stream.allocate(MAX_SPRITES * sprite_size, (instanced ? alignof(SpriteInstance) : sprite_size), &sprites_offset));
+			size_t sprite_count = 0;
 
-			if (cells_visited[5]) {
-				draw_sprite(grid01, glm::vec2(-0.8f, 0.57143f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[6]) {
-				draw_sprite(grid01, glm::vec2(-0.4f, 0.57143f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[7]) {
-				draw_sprite(grid30, glm::vec2(0.0f, 0.57143f), pi/2.0f * 2.0f);
-			}
-			if (cells_visited[8]) {
-				draw_sprite(grid30, glm::vec2(0.4f, 0.57143f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[9]) {
-				draw_sprite(grid10, glm::vec2(0.8f, 0.57143f), pi/2.0f * 0.0f);
-			}
-			
-			if (cells_visited[10]) {
-				draw_sprite(grid21, glm::vec2(-0.8f, 0.28571f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[11]) {
-				draw_sprite(grid11, glm::vec2(-0.4f, 0.28571f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[12]) {
-				draw_sprite(grid30, glm::vec2(0.0f, 0.28571f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[13]) {
-				draw_sprite(grid21, glm::vec2(0.4f, 0.28571f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[14]) {
-				draw_sprite(grid20, glm::vec2(0.8f, 0.28571f), pi/2.0f * 0.0f);
-			}
+			auto draw_sprite = [&](SpriteInfo const &sprite, glm::vec2 const &at, float angle = 0.0f) {
+				if (!sprites || sprite_count == MAX_SPRITES) return;
+				write_sprite(sprites + sprite_count * sprite_size, sprite, at, angle);
+				++sprite_count;
+			};
 
-			if (cells_visited[15]) {
-				draw_sprite(grid01, glm::vec2(-0.8f, 0.0f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[16]) {
-				draw_sprite(grid20, glm::vec2(-0.4f, 0.0f), pi/2.0f * 2.0f);
-			}
-			if (cells_visited[17]) {
-				draw_sprite(grid31, glm::vec2(0.0f, 0.0f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[18]) {
-				draw_sprite(grid31, glm::vec2(0.4f, 0.0f), pi/2.0f * 1.0f);
-			}
-			if (cells_visited[19]) {
-				draw_sprite(grid21, glm::vec2(0.8f, 0.0f), pi/2.0f * 1.0f);
-			}
-			
-			if (cells_visited[20]) {
-				draw_sprite(grid10, glm::vec2(-0.8f, -0.28571f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[21]) {
-				draw_sprite(grid10, glm::vec2(-0.4f, -0.28571f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[22]) {
-				draw_sprite(grid01, glm::vec2(0.0f, -0.28571f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[23]) {
-				draw_sprite(grid10, glm::vec2(0.4f, -0.28571f), pi/2.0f * 0.0f);
-			}
-			if (cells_visited[24]) {
-				draw_sprite(grid01, glm::vec2(0.8f, -0.28571f), pi/2.0f * 1.0f); 
+			//bring the background up to date with any newly visited cells (just those cells' sprites are written):
+			if (!dirty_cells.empty()) {
+				glBindBuffer(GL_ARRAY_BUFFER, background_buffer);
+				//(float vertices are the biggest sprite_size there is)
+				alignas(Vertex) uint8_t data[VERTICES_PER_SPRITE * sizeof(Vertex)];
+				assert(sprite_size <= sizeof(data));
+				for (int cell : dirty_cells) {
+					int &slot = background_slots[cell];
+					if (slot == -1) {
+						if (background_count == MAX_SPRITES) continue;
+						slot = int(background_count++);
+					}
+					CellTile const &tile = cell_tiles[cell];
+					write_sprite(data, *tile.sprite, tile.at, pi/2.0f * tile.turns);
+					glBufferSubData(GL_ARRAY_BUFFER, slot * sprite_size, sprite_size, data);
+				}
+				dirty_cells.clear();
 			}
 
-			if (cells_visited[25]) {
-				draw_sprite(grid21, glm::vec2(-0.8f, -0.57143f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[26]) {
-				draw_sprite(grid31, glm::vec2(-0.4f, -0.57143f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[27]) {
-				draw_sprite(grid31, glm::vec2(0.0f, -0.57143f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[28]) {
-				draw_sprite(grid31, glm::vec2(0.4f, -0.57143f), pi/2.0f * 3.0f);
-			}
-			if (cells_visited[29]) {
-				draw_sprite(grid00, glm::vec2(0.8f, -0.57143f), pi/2.0f * 2.0f); 
-			}
-		 
 			if (cells_visited[4] && !rocks_mined[0]) {
 				draw_sprite(rock, glm::vec2(0.8f, 0.85714f)); 
 			}
@@ -671,18 +1279,110 @@ int main(int argc, char **argv) {
 				draw_sprite(treasure, treasure_pos);
 			}
 
-			glBindBuffer(GL_ARRAY_BUFFER, buffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * verts.size(), &verts[0], GL_STREAM_DRAW);
+			vertex_stream.flush();
 
-			glUseProgram(program);
-			glUniform1i(program_tex, 0);
+			if (palette_tex) {
+				glActiveTexture(GL_TEXTURE1);
+				glBindTexture(GL_TEXTURE_2D, palette_tex);
+				glActiveTexture(GL_TEXTURE0);
+			}
+			//(every tile, in the one bind)
+			if (tiles_tex) {
+				glActiveTexture(GL_TEXTURE2);
+				glBindTexture(GL_TEXTURE_2D_ARRAY, tiles_tex);
+				glActiveTexture(GL_TEXTURE0);
+			}
+			glBindTexture(GL_TEXTURE_2D, tex);
 			glm::mat4 mvp = glm::mat4(1.0f);
-			glUniformMatrix4fv(program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
 
-			glBindTexture(GL_TEXTURE_2D, tex);
-			glBindVertexArray(vao);
+			if (instanced) {
+				glUseProgram(instanced_program);
+				glUniform1i(instanced_program_tex, 0);
+				glUniform1i(instanced_program_palette, 1);
+				glUniform1i(instanced_program_indexed, palette_tex != 0);
+				glUniform1i(instanced_program_tiles, 2);
+				glUniformMatrix4fv(instanced_program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+				glBindVertexArray(instanced_vao);
+			} else if (pulled) {
+				glUseProgram(pulled_program);
+				glUniform1i(pulled_program_tex, 0);
+				glUniform1i(pulled_program_palette, 1);
+				glUniform1i(pulled_program_indexed, palette_tex != 0);
+				glUniform1i(pulled_program_tiles, 2);
+				glUniform1i(pulled_program_records, 3);
+				glUniformMatrix4fv(pulled_program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+				glBindVertexArray(pulled_vao);
+			} else if (compact) {
+				glUseProgram(compact_program);
+				glUniform1i(compact_program_tex, 0);
+				glUniform1i(compact_program_palette, 1);
+				glUniform1i(compact_program_indexed, palette_tex != 0);
+				glUniform1i(compact_program_tiles, 2);
+				glUniformMatrix4fv(compact_program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+				glBindVertexArray(compact_vao);
+			} else {
+				glUseProgram(program);
+				glUniform1i(program_tex, 0);
+				glUniform1i(program_palette, 1);
+				glUniform1i(program_indexed, palette_tex != 0);
+				glUniform1i(program_tiles, 2);
+				glUniformMatrix4fv(program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+				glBindVertexArray(vao);
+			}
 
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, verts.size());
+			//draw 'count' sprites, starting 'offset' bytes into 'from':
+			auto draw_sprites = [&](GLuint from, size_t offset, size_t count) {
+				if (count == 0) return;
+				if (pulled) {
+					//(offsets into either buffer are whole records, since records are allocated at multiples of sprite_size)
+					glActiveTexture(GL_TEXTURE3);
+					glBindTexture(GL_TEXTURE_BUFFER, (from == background_buffer ? background_records_tex : stream_records_tex));
+					glActiveTexture(GL_TEXTURE0);
+					glUniform1i(pulled_program_first_record, GLint(offset / sprite_size));
+					glDrawArrays(GL_TRIANGLES, 0, GLsizei(count * VERTICES_PER_SPRITE));
+					return;
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, from);
+				GLbyte *data = (GLbyte *)0 + offset;
+				if (instanced) {
+					//(GL 3.3 has no base instance, so the per-instance attributes are pointed right at the records)
+					glVertexAttribPointer(instanced_program_At, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, At));
+					glVertexAttribPointer(instanced_program_Angle, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, Angle));
+					glVertexAttribPointer(instanced_program_Layer, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, Layer));
+					glVertexAttribPointer(instanced_program_Rect, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, Rect));
+					glVertexAttribPointer(instanced_program_UVRect, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, UVRect));
+					glVertexAttribPointer(instanced_program_Tint, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), data + offsetof(SpriteInstance, Tint));
+					glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(count));
+				} else if (compact) {
+					glVertexAttribPointer(compact_program_Position, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), data + offsetof(CompactVertex, Position));
+					glVertexAttribPointer(compact_program_TexCoord, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), data + offsetof(CompactVertex, TexCoord));
+					glVertexAttribPointer(compact_program_Layer, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(CompactVertex), data + offsetof(CompactVertex, Layer));
+					glVertexAttribPointer(compact_program_Color, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex), data + offsetof(CompactVertex, Color));
+					glDrawArrays(GL_TRIANGLE_STRIP, 0, GLsizei(count * VERTICES_PER_SPRITE));
+				} else {
+					glVertexAttribPointer(program_Position, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), data + offsetof(Vertex, Position));
+					glVertexAttribPointer(program_TexCoord, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), data + offsetof(Vertex, TexCoord));
+					glVertexAttribPointer(program_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), data + offsetof(Vertex, Color));
+					glDrawArrays(GL_TRIANGLE_STRIP, 0, GLsizei(count * VERTICES_PER_SPRITE));
+				}
+			};
+
+			//background first, then everything else on top:
+			draw_sprites(background_buffer, 0, background_count);
+			draw_sprites(vertex_stream.buffer, sprites_offset, sprite_count);
+			vertex_stream.end_frame();
+		} else { //placeholder frame -- a progress bar, drawn with scissored clears so it needs nothing loaded:
+			float progress = (assets_ready ? 1.0f : loader.progress());
+			glm::ivec2 bar_size = glm::ivec2(config.size.x / 2, 8);
+			glm::ivec2 bar_at = (glm::ivec2(config.size) - bar_size) / 2;
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(bar_at.x, bar_at.y, bar_size.x, bar_size.y);
+			glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glScissor(bar_at.x, bar_at.y, GLsizei(bar_size.x * progress), bar_size.y);
+			glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glDisable(GL_SCISSOR_TEST);
 		}
 
 		SDL_GL_SwapWindow(window);
@@ -691,6 +1391,16 @@ int main(int argc, char **argv) {
 
 	//------------ teardown ------------
 
+	//(the loader's jobs use the assets above, so it has to stop before they go away)
+	loader.cancel();
+	//(frees the unpack buffer if we quit before the texture finished loading)
+	tex_upload.cancel();
+	tex_reload.stop();
+	vertex_stream.destroy();
+	if (background_buffer) glDeleteBuffers(1, &background_buffer);
+	if (stream_records_tex) glDeleteTextures(1, &stream_records_tex);
+	if (background_records_tex) glDeleteTextures(1, &background_records_tex);
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -741,3 +1451,56 @@ static GLuint link_program(GLuint fragment_shader, GLuint vertex_shader) {
 	}
 	return program;
 }
+
+//images are decoded with the codec matching their extension (PNG unless it says otherwise):
+static bool is_qoi(std::string const &filename) {
+	return filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".qoi") == 0;
+}
+
+static bool is_mips(std::string const &filename) {
+	return filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".mips") == 0;
+}
+
+//PNGs are decoded once and then served from a cache of raw pixels next to them;
+// QOIs decode about as fast as the cache would load, so they are read directly:
+static bool load_image(std::string const &filename, CachedImage *image, OriginLocation origin, AlphaMode alpha) {
+	if (is_qoi(filename)) {
+		//(mapped once, for both the header and the pixels)
+		MappedFile file;
+		if (!file.open(filename)) return false;
+		unsigned int w, h;
+		if (!load_qoi_info(file.data, file.size, &w, &h)) return false;
+		image->storage.reset(new uint8_t[size_t(w) * h * 4]);
+		uint32_t *pixels = reinterpret_cast< uint32_t * >(image->storage.get());
+		if (!load_qoi(file.data, file.size, w, h, pixels, w, origin)) return false;
+		if (alpha == PremultipliedAlpha) premultiply_alpha(pixels, size_t(w) * h);
+		image->width = w;
+		image->height = h;
+		image->channels = 4;
+		image->data = image->storage.get();
+		return true;
+	} else {
+		return load_png_cached(filename, filename + ".cache", image, origin, alpha);
+	}
+}
+
+static bool has_gl_extension(char const *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		char const *extension = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && std::strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
+
+//upload one level of the bound GL_TEXTURE_2D -- 'blocks' (the level already block-compressed to 'format') if given,
+// else the RGBA8 pixels themselves (all of a texture's levels must be given the same format):
+static void upload_rgba_level(unsigned int level, unsigned int width, unsigned int height, uint32_t const *pixels, std::vector< uint8_t > const *blocks, BlockFormat format) {
+	if (blocks) {
+		GLenum internal_format = (format == BlockBC1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0, GLsizei(blocks->size()), blocks->data());
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+}
@@ -0,0 +1,135 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) : data(other.data), size(other.size) {
+	other.data = nullptr;
+	other.size = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+	if (this != &other) {
+		close();
+		data = other.data;
+		size = other.size;
+		other.data = nullptr;
+		other.size = 0;
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(std::string const &filename, bool quiet) {
+	close();
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		if (!quiet) LOG_ERROR("  cannot open file.");
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		LOG_ERROR("  cannot get file size.");
+		CloseHandle(file);
+		return false;
+	}
+	if (file_size.QuadPart == 0) {
+		//empty files can't be mapped, but they are still valid files:
+		CloseHandle(file);
+		return true;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		LOG_ERROR("  cannot create file mapping.");
+		return false;
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	//the view keeps the mapping alive:
+	CloseHandle(mapping);
+	if (view == NULL) {
+		LOG_ERROR("  cannot map file.");
+		return false;
+	}
+	data = reinterpret_cast< uint8_t const * >(view);
+	size = size_t(file_size.QuadPart);
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+#else
+
+bool MappedFile::open(std::string const &filename, bool quiet) {
+	close();
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (!quiet) LOG_ERROR("  cannot open file.");
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		LOG_ERROR("  cannot stat file.");
+		::close(fd);
+		return false;
+	}
+	if (info.st_size == 0) {
+		//empty files can't be mapped, but they are still valid files:
+		::close(fd);
+		return true;
+	}
+	void *addr = mmap(NULL, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	//the mapping holds its own reference to the file:
+	::close(fd);
+	if (addr == MAP_FAILED) {
+		LOG_ERROR("  cannot map file.");
+		return false;
+	}
+	//decoders walk the file front-to-back:
+	madvise(addr, size_t(info.st_size), MADV_SEQUENTIAL);
+	data = reinterpret_cast< uint8_t const * >(addr);
+	size = size_t(info.st_size);
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		munmap(const_cast< uint8_t * >(data), size);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+#endif
+
+uint64_t hash_bytes(uint8_t const *bytes, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
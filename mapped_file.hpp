@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Read-only memory mapping of a whole file.
+ * The mapping is released when the MappedFile is closed or destroyed.
+ */
+
+struct MappedFile {
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+	MappedFile(MappedFile &&other);
+	MappedFile &operator=(MappedFile &&other);
+
+	//map 'filename' (replacing any current mapping); returns false (and, unless quiet, logs) on failure:
+	bool open(std::string const &filename, bool quiet = false);
+	void close();
+
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+};
+
+//64-bit FNV-1a -- what file contents (texture cache keys) and asset names (pack directories) are hashed with:
+uint64_t hash_bytes(uint8_t const *bytes, size_t size);
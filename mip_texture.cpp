@@ -0,0 +1,144 @@
+#include "mip_texture.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+static const char MIP_MAGIC[8] = {'p','x','m','i','p','s','\0','\0'};
+static const uint32_t MIP_VERSION = 1;
+//the header and every level start on a page boundary:
+static const size_t MIP_PAGE_SIZE = 4096;
+
+struct MipHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t cell_size;
+	uint32_t origin;
+	uint32_t alpha;
+	uint32_t padding;
+	uint64_t offsets[MIP_MAX_LEVELS];
+};
+static_assert(sizeof(MipHeader) <= MIP_PAGE_SIZE, "Mip header fits in its page.");
+
+static size_t level_bytes(uint32_t width, uint32_t height, uint32_t level) {
+	return size_t(width >> level) * (height >> level) * sizeof(uint32_t);
+}
+
+uint32_t const *MipTexture::level(unsigned int level) const {
+	assert(level < levels);
+	return reinterpret_cast< uint32_t const * >(data + offsets[level]);
+}
+
+static void clear(MipTexture *texture) {
+	assert(texture);
+	texture->width = texture->height = texture->levels = texture->cell_size = 0;
+	texture->data = nullptr;
+	texture->file.close();
+}
+
+//'name' is only for messages:
+static bool read_mip_texture(uint8_t const *bytes, size_t size, std::string const &name, MipTexture *texture) {
+	MipHeader header;
+	if (size < MIP_PAGE_SIZE) {
+		LOG_ERROR("Mip texture " << name << " is too short to hold a header.");
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (memcmp(header.magic, MIP_MAGIC, sizeof(MIP_MAGIC)) != 0 || header.version != MIP_VERSION) {
+		LOG_ERROR(name << " is not a (version " << MIP_VERSION << ") mip texture.");
+		return false;
+	}
+	if (header.levels == 0 || header.levels > MIP_MAX_LEVELS || (header.width >> (header.levels - 1)) == 0 || (header.height >> (header.levels - 1)) == 0) {
+		LOG_ERROR("Mip texture " << name << " has a bad level count (" << header.levels << ").");
+		return false;
+	}
+	for (uint32_t l = 0; l < header.levels; ++l) {
+		if (header.offsets[l] % MIP_PAGE_SIZE != 0 || header.offsets[l] < MIP_PAGE_SIZE
+		 || header.offsets[l] > size || size - header.offsets[l] < level_bytes(header.width, header.height, l)) {
+			LOG_ERROR("Mip texture " << name << " has a bad offset for level " << l << ".");
+			return false;
+		}
+	}
+
+	texture->width = header.width;
+	texture->height = header.height;
+	texture->levels = header.levels;
+	texture->cell_size = header.cell_size;
+	texture->origin = OriginLocation(header.origin);
+	texture->alpha = AlphaMode(header.alpha);
+	memcpy(texture->offsets, header.offsets, sizeof(header.offsets));
+	texture->data = bytes;
+	return true;
+}
+
+bool load_mip_texture(std::string const &filename, MipTexture *texture) {
+	clear(texture);
+
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	if (!read_mip_texture(file.data, file.size, "'" + filename + "'", texture)) {
+		return false;
+	}
+	//(moving the mapping leaves it where it is, so 'data' stays good)
+	texture->file = std::move(file);
+	return true;
+}
+
+bool load_mip_texture(uint8_t const *bytes, size_t size, MipTexture *texture) {
+	clear(texture);
+	return read_mip_texture(bytes, size, "(in memory)", texture);
+}
+
+bool save_mip_texture(std::string const &filename, unsigned int width, unsigned int height, unsigned int cell_size, std::vector< std::vector< uint32_t > > const &levels, OriginLocation origin, AlphaMode alpha) {
+	if (levels.empty() || levels.size() > MIP_MAX_LEVELS) {
+		LOG_ERROR("Can't save " << levels.size() << " mip levels (need 1 to " << MIP_MAX_LEVELS << ").");
+		return false;
+	}
+	MipHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MIP_MAGIC, sizeof(MIP_MAGIC));
+	header.version = MIP_VERSION;
+	header.width = width;
+	header.height = height;
+	header.levels = uint32_t(levels.size());
+	header.cell_size = cell_size;
+	header.origin = uint32_t(origin);
+	header.alpha = uint32_t(alpha);
+	uint64_t offset = MIP_PAGE_SIZE;
+	for (uint32_t l = 0; l < header.levels; ++l) {
+		if (levels[l].size() * sizeof(uint32_t) != level_bytes(width, height, l)) {
+			LOG_ERROR("Mip level " << l << " has " << levels[l].size() << " pixels, expecting " << (width >> l) << "x" << (height >> l) << ".");
+			return false;
+		}
+		header.offsets[l] = offset;
+		offset += (level_bytes(width, height, l) + MIP_PAGE_SIZE - 1) / MIP_PAGE_SIZE * MIP_PAGE_SIZE;
+	}
+
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	std::vector< char > page(MIP_PAGE_SIZE, 0);
+	memcpy(&page[0], &header, sizeof(header));
+	file.write(&page[0], page.size());
+	memset(&page[0], 0, sizeof(header));
+	for (uint32_t l = 0; l < header.levels; ++l) {
+		size_t bytes = level_bytes(width, height, l);
+		file.write(reinterpret_cast< char const * >(levels[l].data()), bytes);
+		//pad out to the next page:
+		file.write(&page[0], (MIP_PAGE_SIZE - bytes % MIP_PAGE_SIZE) % MIP_PAGE_SIZE);
+	}
+	if (!file) {
+		LOG_ERROR("Failed to write mip texture '" << filename << "'.");
+		file.close();
+		std::remove(filename.c_str());
+		return false;
+	}
+	return true;
+}
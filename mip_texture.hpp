@@ -0,0 +1,44 @@
+#pragma once
+
+#include "load_save_png.hpp"
+#include "mapped_file.hpp"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+ * Texture container holding a precomputed mip chain (built offline by build_mips).
+ * A file is a page-sized header followed by each level's RGBA8 pixels, every level starting on a
+ * page boundary, so loading is a single mmap and each level goes to GL straight out of the mapping.
+ * (The same goes for a .mips compiled into the executable; see embedded_assets.hpp.)
+ */
+
+const unsigned int MIP_MAX_LEVELS = 16;
+
+struct MipTexture {
+	unsigned int width = 0; //level 0 size
+	unsigned int height = 0;
+	unsigned int levels = 0;
+	//atlas cell size the chain was built for (levels stop once a cell is one texel):
+	unsigned int cell_size = 0;
+	OriginLocation origin = LowerLeftOrigin;
+	AlphaMode alpha = StraightAlpha;
+
+	unsigned int level_width(unsigned int level) const { return width >> level; }
+	unsigned int level_height(unsigned int level) const { return height >> level; }
+	//level_width(level) * level_height(level) pixels; valid as long as this MipTexture is:
+	uint32_t const *level(unsigned int level) const;
+
+	//the whole file -- in 'file', or wherever load_mip_texture was handed it:
+	uint8_t const *data = nullptr;
+	MappedFile file;
+	uint64_t offsets[MIP_MAX_LEVELS] = {};
+};
+
+bool load_mip_texture(std::string const &filename, MipTexture *texture);
+//from a whole .mips file already in memory (which must stay there as long as the texture is used):
+bool load_mip_texture(uint8_t const *bytes, size_t size, MipTexture *texture);
+
+//levels[i] holds level i, which must be exactly (width >> i) x (height >> i):
+bool save_mip_texture(std::string const &filename, unsigned int width, unsigned int height, unsigned int cell_size, std::vector< std::vector< uint32_t > > const &levels, OriginLocation origin, AlphaMode alpha);
@@ -0,0 +1,310 @@
+#include "sprite_table.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Packs sprites into an atlas and writes the sprite table (see sprite_table.hpp) that goes with it.
+//usage: pack_atlas <out.png> <out.sprites> <sprites.list>
+//(outputs first, so it can be run by jam's GenFile rule)
+//
+//The list file has one sprite per line:
+//  <name> <image> [x y w h]
+//taking the given texel rect (upper-left origin) of image -- or all of it -- with image paths relative
+// to the list file. Settings lines, which apply to the whole atlas, may come anywhere:
+//  padding <texels>  -- space around each sprite, filled by repeating the sprite's edge texels
+//  align <texels>    -- sprites (with padding) are placed in whole align x align cells
+//  trim <0|1>        -- drop fully transparent rows and columns from sprite edges
+//'#' starts a comment line.
+//
+//Placement is MaxRects with the bottom-left rule, tried at every atlas width (in align steps) from the
+// widest sprite up; the smallest resulting area wins.
+
+struct Rect {
+	unsigned int x, y, w, h;
+};
+
+struct Input {
+	std::string name;
+	std::string image;
+	Rect rect; //in image, before trimming
+	bool whole; //rect is the whole image
+	Rect trimmed; //in image, after trimming
+	unsigned int slot_w, slot_h; //trimmed size plus padding, rounded up to align
+	Rect slot; //placement in the atlas
+};
+
+struct Image {
+	unsigned int width = 0, height = 0;
+	std::vector< uint32_t > pixels;
+};
+
+static bool contains(Rect const &a, Rect const &b) {
+	return b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h;
+}
+
+//free-rectangle bookkeeping for one MaxRects bin:
+struct MaxRects {
+	std::vector< Rect > free;
+
+	MaxRects(unsigned int width, unsigned int height) {
+		free.emplace_back(Rect{0, 0, width, height});
+	}
+
+	//bottom-left rule: lowest resulting bottom edge, then leftmost:
+	bool place(unsigned int w, unsigned int h, Rect *placed) {
+		bool found = false;
+		for (auto const &f : free) {
+			if (w > f.w || h > f.h) continue;
+			if (!found || f.y + h < placed->y + placed->h || (f.y + h == placed->y + placed->h && f.x < placed->x)) {
+				*placed = Rect{f.x, f.y, w, h};
+				found = true;
+			}
+		}
+		if (!found) return false;
+
+		//split every free rect the placement overlaps into the (up to four) parts around it:
+		std::vector< Rect > next;
+		next.reserve(free.size() + 4);
+		Rect const &p = *placed;
+		for (auto const &f : free) {
+			if (p.x >= f.x + f.w || p.x + p.w <= f.x || p.y >= f.y + f.h || p.y + p.h <= f.y) {
+				next.emplace_back(f);
+				continue;
+			}
+			if (p.x > f.x) next.emplace_back(Rect{f.x, f.y, p.x - f.x, f.h});
+			if (p.x + p.w < f.x + f.w) next.emplace_back(Rect{p.x + p.w, f.y, f.x + f.w - (p.x + p.w), f.h});
+			if (p.y > f.y) next.emplace_back(Rect{f.x, f.y, f.w, p.y - f.y});
+			if (p.y + p.h < f.y + f.h) next.emplace_back(Rect{f.x, p.y + p.h, f.w, f.y + f.h - (p.y + p.h)});
+		}
+		//...and drop any free rect inside another:
+		free.clear();
+		for (size_t i = 0; i < next.size(); ++i) {
+			bool redundant = false;
+			for (size_t j = 0; j < next.size() && !redundant; ++j) {
+				if (i == j || !contains(next[j], next[i])) continue;
+				//(of two identical rects, keep the first)
+				redundant = !contains(next[i], next[j]) || j < i;
+			}
+			if (!redundant) free.emplace_back(next[i]);
+		}
+		return true;
+	}
+};
+
+//pack into an atlas 'width' wide; returns the height used (rounded up to align):
+static unsigned int pack(std::vector< Input > &inputs, unsigned int width, unsigned int align) {
+	MaxRects bin(width, ~0U / 2);
+	unsigned int height = 0;
+	for (auto &input : inputs) {
+		if (!bin.place(input.slot_w, input.slot_h, &input.slot)) return ~0U;
+		height = std::max(height, input.slot.y + input.slot.h);
+	}
+	return (height + align - 1) / align * align;
+}
+
+static bool parse_unsigned(std::istream &in, unsigned int *value) {
+	long v = -1;
+	if (!(in >> v) || v < 0) return false;
+	*value = unsigned(v);
+	return true;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 4) {
+		std::cerr << "usage: " << argv[0] << " <out.png> <out.sprites> <sprites.list>" << std::endl;
+		return 1;
+	}
+	std::string out_png = argv[1];
+	std::string out_table = argv[2];
+	std::string list_filename = argv[3];
+	std::string list_dir;
+	{
+		size_t slash = list_filename.find_last_of("/\\");
+		if (slash != std::string::npos) list_dir = list_filename.substr(0, slash + 1);
+	}
+
+	unsigned int padding = 0;
+	unsigned int align = 1;
+	bool trim = true;
+	std::vector< Input > inputs;
+	{ //read the list:
+		std::ifstream list(list_filename.c_str(), std::ios::binary);
+		if (!list) {
+			std::cerr << "Failed to open '" << list_filename << "'." << std::endl;
+			return 1;
+		}
+		std::string line;
+		for (unsigned int line_number = 1; std::getline(list, line); ++line_number) {
+			if (line.empty() || line[0] == '#') continue;
+			std::istringstream in(line);
+			std::string first;
+			if (!(in >> first)) continue;
+			bool ok = true;
+			if (first == "padding") {
+				ok = parse_unsigned(in, &padding);
+			} else if (first == "align") {
+				ok = parse_unsigned(in, &align) && align > 0;
+			} else if (first == "trim") {
+				unsigned int t = 0;
+				ok = parse_unsigned(in, &t) && t <= 1;
+				trim = (t != 0);
+			} else {
+				Input input;
+				input.name = first;
+				input.whole = true;
+				ok = bool(in >> input.image);
+				input.image = list_dir + input.image;
+				in >> std::ws;
+				if (ok && !in.eof()) {
+					input.whole = false;
+					ok = parse_unsigned(in, &input.rect.x) && parse_unsigned(in, &input.rect.y)
+					  && parse_unsigned(in, &input.rect.w) && parse_unsigned(in, &input.rect.h)
+					  && input.rect.w > 0 && input.rect.h > 0;
+				}
+				inputs.emplace_back(input);
+			}
+			if (!ok) {
+				std::cerr << list_filename << ":" << line_number << ": can't make sense of '" << line << "'." << std::endl;
+				return 1;
+			}
+		}
+	}
+	if (inputs.empty()) {
+		std::cerr << "'" << list_filename << "' lists no sprites." << std::endl;
+		return 1;
+	}
+
+	//load images (each once) and work out what to take from each:
+	std::map< std::string, Image > images;
+	for (auto &input : inputs) {
+		auto f = images.find(input.image);
+		if (f == images.end()) {
+			f = images.emplace(input.image, Image()).first;
+			if (!load_png(input.image, &f->second.width, &f->second.height, &f->second.pixels, UpperLeftOrigin)) {
+				std::cerr << "Failed to load '" << input.image << "' (for sprite '" << input.name << "')." << std::endl;
+				return 1;
+			}
+		}
+		Image const &image = f->second;
+		if (input.whole) {
+			input.rect = Rect{0, 0, image.width, image.height};
+		} else if (input.rect.x + input.rect.w > image.width || input.rect.y + input.rect.h > image.height) {
+			std::cerr << "Sprite '" << input.name << "' doesn't fit in '" << input.image << "' (" << image.width << "x" << image.height << ")." << std::endl;
+			return 1;
+		}
+
+		input.trimmed = input.rect;
+		if (trim) {
+			Rect const &r = input.rect;
+			unsigned int min_x = r.x + r.w, min_y = r.y + r.h, max_x = r.x, max_y = r.y;
+			for (unsigned int y = r.y; y < r.y + r.h; ++y) {
+				for (unsigned int x = r.x; x < r.x + r.w; ++x) {
+					if ((image.pixels[size_t(y) * image.width + x] >> 24) == 0) continue;
+					min_x = std::min(min_x, x);
+					min_y = std::min(min_y, y);
+					max_x = std::max(max_x, x + 1);
+					max_y = std::max(max_y, y + 1);
+				}
+			}
+			//(fully transparent sprites keep a single texel)
+			if (min_x >= max_x) {
+				min_x = r.x; max_x = r.x + 1;
+				min_y = r.y; max_y = r.y + 1;
+			}
+			input.trimmed = Rect{min_x, min_y, max_x - min_x, max_y - min_y};
+		}
+		input.slot_w = (input.trimmed.w + 2 * padding + align - 1) / align * align;
+		input.slot_h = (input.trimmed.h + 2 * padding + align - 1) / align * align;
+	}
+
+	//tallest first (then widest) suits the bottom-left rule:
+	std::stable_sort(inputs.begin(), inputs.end(), [](Input const &a, Input const &b) {
+		if (a.slot_h != b.slot_h) return a.slot_h > b.slot_h;
+		return a.slot_w > b.slot_w;
+	});
+
+	unsigned int min_width = 0;
+	uint64_t total_area = 0;
+	for (auto const &input : inputs) {
+		min_width = std::max(min_width, input.slot_w);
+		total_area += uint64_t(input.slot_w) * input.slot_h;
+	}
+	//(nothing wider than twice the square that would hold every slot can win)
+	unsigned int max_width = std::max(min_width, 2 * unsigned(std::sqrt(double(total_area))) + align);
+
+	unsigned int best_width = 0, best_height = 0;
+	for (unsigned int width = min_width; width <= max_width; width += align) {
+		unsigned int height = pack(inputs, width, align);
+		uint64_t area = uint64_t(width) * height;
+		uint64_t best_area = uint64_t(best_width) * best_height;
+		//smallest area, then squarest:
+		if (best_width == 0 || area < best_area || (area == best_area && std::max(width, height) < std::max(best_width, best_height))) {
+			best_width = width;
+			best_height = height;
+		}
+	}
+	pack(inputs, best_width, align);
+
+	//copy sprites into place, repeating edge texels out to the edges of each slot:
+	std::vector< uint32_t > atlas(size_t(best_width) * best_height, 0);
+	SpriteTable table;
+	table.width = best_width;
+	table.height = best_height;
+	table.align = align;
+	for (auto const &input : inputs) {
+		Image const &image = images[input.image];
+		Rect const &t = input.trimmed;
+		for (unsigned int y = 0; y < input.slot_h; ++y) {
+			unsigned int sy = t.y + unsigned(std::min(std::max(int(y) - int(padding), 0), int(t.h) - 1));
+			for (unsigned int x = 0; x < input.slot_w; ++x) {
+				unsigned int sx = t.x + unsigned(std::min(std::max(int(x) - int(padding), 0), int(t.w) - 1));
+				atlas[size_t(input.slot.y + y) * best_width + (input.slot.x + x)] = image.pixels[size_t(sy) * image.width + sx];
+			}
+		}
+
+		Sprite sprite;
+		sprite.x = input.slot.x + padding;
+		sprite.y = input.slot.y + padding;
+		sprite.w = t.w;
+		sprite.h = t.h;
+		sprite.trim_x = t.x - input.rect.x;
+		sprite.trim_y = t.y - input.rect.y;
+		sprite.source_width = input.rect.w;
+		sprite.source_height = input.rect.h;
+		if (!table.sprites.emplace(input.name, sprite).second) {
+			std::cerr << "Sprite '" << input.name << "' is listed twice." << std::endl;
+			return 1;
+		}
+	}
+
+	{ //(through a stream, so a failed write can be caught here rather than passing unnoticed)
+		std::ofstream png(out_png.c_str(), std::ios::binary);
+		save_png(png, best_width, best_height, atlas.data(), UpperLeftOrigin);
+		if (!png) {
+			std::cerr << "Failed to write atlas '" << out_png << "'." << std::endl;
+			png.close();
+			std::remove(out_png.c_str());
+			return 1;
+		}
+	}
+	if (!save_sprite_table(out_table, table)) {
+		return 1;
+	}
+
+	uint64_t used = 0;
+	for (auto const &input : inputs) {
+		used += uint64_t(input.trimmed.w) * input.trimmed.h;
+	}
+	std::cout << "Packed " << inputs.size() << " sprites into " << best_width << "x" << best_height
+	          << " (" << (100 * used / (uint64_t(best_width) * best_height)) << "% used) in '" << out_png << "'." << std::endl;
+	return 0;
+}
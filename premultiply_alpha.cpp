@@ -0,0 +1,103 @@
+#include "premultiply_alpha.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PREMULTIPLY_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+//All paths compute round(c * a / 255) as (x + (x >> 8)) >> 8 with x = c * a + 128, which is exact
+// for 8-bit c and a and fits in 16 bits, so the vector paths can stay in 16-bit lanes.
+
+static inline void premultiply_scalar(uint32_t *data, size_t count) {
+	uint8_t *px = reinterpret_cast< uint8_t * >(data);
+	for (size_t i = 0; i < count; ++i, px += 4) {
+		uint32_t a = px[3];
+		for (unsigned int c = 0; c < 3; ++c) {
+			uint32_t x = px[c] * a + 128;
+			px[c] = uint8_t((x + (x >> 8)) >> 8);
+		}
+	}
+}
+
+#if defined(__AVX2__)
+
+void premultiply_alpha(uint32_t *data, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi16(128);
+	//in 16-bit lanes, alpha sits in every fourth lane; multiply it by 255 so it comes back unchanged:
+	const __m256i alpha_lanes = _mm256_set1_epi64x(0xffff000000000000LL);
+	const __m256i alpha_255 = _mm256_set1_epi64x(0x00ff000000000000LL);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i px = _mm256_loadu_si256(reinterpret_cast< __m256i const * >(data + i));
+		__m256i halves[2] = { _mm256_unpacklo_epi8(px, zero), _mm256_unpackhi_epi8(px, zero) };
+		for (__m256i &h : halves) {
+			__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(h, 0xff), 0xff);
+			a = _mm256_or_si256(_mm256_andnot_si256(alpha_lanes, a), alpha_255);
+			__m256i x = _mm256_add_epi16(_mm256_mullo_epi16(h, a), round);
+			h = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+		}
+		_mm256_storeu_si256(reinterpret_cast< __m256i * >(data + i), _mm256_packus_epi16(halves[0], halves[1]));
+	}
+	premultiply_scalar(data + i, count - i);
+}
+
+#elif defined(PREMULTIPLY_SSE2)
+
+void premultiply_alpha(uint32_t *data, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	//in 16-bit lanes, alpha sits in every fourth lane; multiply it by 255 so it comes back unchanged:
+	const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	const __m128i alpha_255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i px = _mm_loadu_si128(reinterpret_cast< __m128i const * >(data + i));
+		__m128i halves[2] = { _mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero) };
+		for (__m128i &h : halves) {
+			__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(h, 0xff), 0xff);
+			a = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), alpha_255);
+			__m128i x = _mm_add_epi16(_mm_mullo_epi16(h, a), round);
+			h = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+		}
+		_mm_storeu_si128(reinterpret_cast< __m128i * >(data + i), _mm_packus_epi16(halves[0], halves[1]));
+	}
+	premultiply_scalar(data + i, count - i);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+void premultiply_alpha(uint32_t *data, size_t count) {
+	uint8_t *bytes = reinterpret_cast< uint8_t * >(data);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint8x8x4_t px = vld4_u8(bytes + i * 4);
+		for (unsigned int c = 0; c < 3; ++c) {
+			uint16x8_t p = vmull_u8(px.val[c], px.val[3]);
+			//(p + 128 + ((p + 128) >> 8)) >> 8, via rounding shifts:
+			px.val[c] = vrshrn_n_u16(vrsraq_n_u16(p, p, 8), 8);
+		}
+		vst4_u8(bytes + i * 4, px);
+	}
+	premultiply_scalar(data + i, count - i);
+}
+
+#else
+
+void premultiply_alpha(uint32_t *data, size_t count) {
+	premultiply_scalar(data, count);
+}
+
+#endif
+
+//gray+alpha data is only used for small mask-style images, so it isn't worth its own vector paths:
+void premultiply_gray_alpha(uint8_t *data, size_t count) {
+	for (size_t i = 0; i < count; ++i, data += 2) {
+		uint32_t x = data[0] * uint32_t(data[1]) + 128;
+		data[0] = uint8_t((x + (x >> 8)) >> 8);
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Convert RGBA8 pixels from straight to premultiplied alpha, in place:
+ *  rgb = round(rgb * a / 255), alpha is unchanged.
+ * Uses AVX2, SSE2 or NEON where the compiler targets them; every path gives bit-identical results.
+ */
+
+void premultiply_alpha(uint32_t *data, size_t count);
+
+//same, for two-channel gray+alpha (RG8) pixels:
+void premultiply_gray_alpha(uint8_t *data, size_t count);
@@ -0,0 +1,247 @@
+#include "save_png_parallel.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+using std::vector;
+
+//deflate's window, and so the most a strip can usefully borrow from the one before it:
+static const size_t DICTIONARY_SIZE = 32768;
+//aim for strips about this big (filtered, uncompressed) so there are enough to keep every thread busy:
+static const size_t STRIP_BYTES = 256 * 1024;
+
+namespace {
+
+struct Image {
+	unsigned int width;
+	unsigned int height;
+	uint32_t const *data;
+	OriginLocation origin;
+
+	//rows in file order (top row first):
+	uint8_t const *row(unsigned int r) const {
+		unsigned int at = (origin == UpperLeftOrigin ? r : height - 1 - r);
+		return reinterpret_cast< uint8_t const * >(data + size_t(at) * width);
+	}
+	size_t row_bytes() const {
+		return size_t(width) * 4;
+	}
+};
+
+struct Strip {
+	unsigned int begin = 0;
+	unsigned int count = 0;
+	//raw deflate data, ending in a sync flush (or the final block for the last strip):
+	vector< uint8_t > compressed;
+	uLong adler = 0;
+	size_t length = 0;
+	bool ok = false;
+};
+
+}
+
+//filter rows [begin, begin+count) into 'out' (1 + row_bytes per row), picking Sub or Up per row by
+// the usual minimum-sum-of-absolute-differences heuristic:
+static void filter_rows(Image const &image, unsigned int begin, unsigned int count, uint8_t *out) {
+	size_t row_bytes = image.row_bytes();
+	for (unsigned int r = begin; r < begin + count; ++r) {
+		uint8_t const *cur = image.row(r);
+		uint8_t *sub = out + 1;
+		for (size_t i = 0; i < row_bytes; ++i) {
+			sub[i] = uint8_t(cur[i] - (i >= 4 ? cur[i-4] : 0));
+		}
+		if (r > 0) {
+			uint8_t const *prev = image.row(r - 1);
+			uint32_t sub_cost = 0, up_cost = 0;
+			for (size_t i = 0; i < row_bytes; ++i) {
+				uint8_t up = uint8_t(cur[i] - prev[i]);
+				sub_cost += (sub[i] < 128 ? sub[i] : 256 - sub[i]);
+				up_cost += (up < 128 ? up : 256 - up);
+			}
+			if (up_cost < sub_cost) {
+				for (size_t i = 0; i < row_bytes; ++i) {
+					sub[i] = uint8_t(cur[i] - prev[i]);
+				}
+				out[0] = 2; //Up
+			} else {
+				out[0] = 1; //Sub
+			}
+		} else {
+			out[0] = 1; //Sub
+		}
+		out += 1 + row_bytes;
+	}
+}
+
+static void compress_strip(Image const &image, Strip *strip, bool first, bool last, int level) {
+	size_t filtered_row = 1 + image.row_bytes();
+	vector< uint8_t > input(filtered_row * strip->count);
+	filter_rows(image, strip->begin, strip->count, input.data());
+	strip->adler = adler32(adler32(0L, Z_NULL, 0), input.data(), uInt(input.size()));
+	strip->length = input.size();
+
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+	if (!first) {
+		//re-filter the tail of the previous strip to use as a dictionary, so matches can reach back across the seam:
+		unsigned int rows = unsigned(std::min< size_t >(strip->begin, (DICTIONARY_SIZE + filtered_row - 1) / filtered_row));
+		vector< uint8_t > dictionary(filtered_row * rows);
+		filter_rows(image, strip->begin - rows, rows, dictionary.data());
+		size_t use = std::min(dictionary.size(), DICTIONARY_SIZE);
+		deflateSetDictionary(&z, dictionary.data() + dictionary.size() - use, uInt(use));
+	}
+
+	strip->compressed.resize(deflateBound(&z, uLong(input.size())) + 16);
+	z.next_in = input.data();
+	z.avail_in = uInt(input.size());
+	int flush = (last ? Z_FINISH : Z_SYNC_FLUSH);
+	while (true) {
+		z.next_out = strip->compressed.data() + z.total_out;
+		z.avail_out = uInt(strip->compressed.size() - z.total_out);
+		int ret = deflate(&z, flush);
+		if (ret == Z_STREAM_ERROR) break;
+		if (last ? (ret == Z_STREAM_END) : (z.avail_in == 0 && z.avail_out > 0)) {
+			strip->compressed.resize(z.total_out);
+			strip->ok = true;
+			break;
+		}
+		//ran out of output space:
+		strip->compressed.resize(strip->compressed.size() * 2);
+	}
+	deflateEnd(&z);
+}
+
+static void write_u32(std::ostream &to, uint32_t val) {
+	char bytes[4] = { char(val >> 24), char(val >> 16), char(val >> 8), char(val) };
+	to.write(bytes, 4);
+}
+
+//chunk data may come in pieces (prefix + body + suffix) so IDATs can be written without gluing buffers together:
+static void write_chunk(std::ostream &to, char const *type, vector< std::pair< uint8_t const *, size_t > > const &pieces) {
+	size_t length = 0;
+	for (auto const &piece : pieces) length += piece.second;
+	write_u32(to, uint32_t(length));
+	to.write(type, 4);
+	uLong crc = crc32(0L, reinterpret_cast< Bytef const * >(type), 4);
+	for (auto const &piece : pieces) {
+		to.write(reinterpret_cast< char const * >(piece.first), piece.second);
+		crc = crc32(crc, piece.first, uInt(piece.second));
+	}
+	write_u32(to, uint32_t(crc));
+}
+
+bool save_png_parallel(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, unsigned int threads, int level) {
+	if (width == 0 || height == 0 || width > 0x7fffffffU / 4 || height > 0x7fffffffU) {
+		LOG_ERROR("Can't write a " << width << "x" << height << " png.");
+		return false;
+	}
+	assert(data);
+	level = std::max(0, std::min(9, level));
+
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.data = data;
+	image.origin = origin;
+
+	//cut into strips:
+	size_t filtered_row = 1 + image.row_bytes();
+	unsigned int strip_rows = unsigned(std::max< size_t >(1, STRIP_BYTES / filtered_row));
+	vector< Strip > strips((height + strip_rows - 1) / strip_rows);
+	for (size_t i = 0; i < strips.size(); ++i) {
+		strips[i].begin = unsigned(i) * strip_rows;
+		strips[i].count = std::min(strip_rows, height - strips[i].begin);
+	}
+
+	//compress strips on a pool of workers:
+	vector< std::promise< void > > done(strips.size());
+	vector< std::future< void > > ready;
+	for (auto &d : done) ready.emplace_back(d.get_future());
+	std::atomic< size_t > next(0);
+	if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+	threads = unsigned(std::min< size_t >(threads, strips.size()));
+	vector< std::thread > workers;
+	for (unsigned int t = 0; t < threads; ++t) {
+		workers.emplace_back([&]() {
+			while (true) {
+				size_t i = next.fetch_add(1);
+				if (i >= strips.size()) break;
+				compress_strip(image, &strips[i], i == 0, i + 1 == strips.size(), level);
+				done[i].set_value();
+			}
+		});
+	}
+
+	//meanwhile, write strips out in order as they finish:
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	to.write(reinterpret_cast< char const * >(signature), sizeof(signature));
+
+	uint8_t ihdr[13] = {
+		uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+		uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height),
+		8, //bit depth
+		6, //color type: RGBA
+		0, 0, 0 //compression, filter, interlace
+	};
+	write_chunk(to, "IHDR", {{ihdr, sizeof(ihdr)}});
+
+	//zlib header, with FLEVEL matching the level as zlib itself would set it:
+	uint8_t zlib_header[2] = {0x78, uint8_t((level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6)};
+	zlib_header[1] += (31 - (zlib_header[0] * 256 + zlib_header[1]) % 31) % 31;
+
+	bool ok = true;
+	uLong adler = adler32(0L, Z_NULL, 0);
+	for (size_t i = 0; i < strips.size(); ++i) {
+		ready[i].wait();
+		Strip &strip = strips[i];
+		if (!strip.ok) ok = false;
+		if (!ok) continue;
+		adler = adler32_combine(adler, strip.adler, z_off_t(strip.length));
+
+		vector< std::pair< uint8_t const *, size_t > > pieces;
+		if (i == 0) pieces.emplace_back(zlib_header, sizeof(zlib_header));
+		pieces.emplace_back(strip.compressed.data(), strip.compressed.size());
+		uint8_t trailer[4] = { uint8_t(adler >> 24), uint8_t(adler >> 16), uint8_t(adler >> 8), uint8_t(adler) };
+		if (i + 1 == strips.size()) pieces.emplace_back(trailer, sizeof(trailer));
+		write_chunk(to, "IDAT", pieces);
+		vector< uint8_t >().swap(strip.compressed);
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	if (!ok) {
+		LOG_ERROR("Error compressing png.");
+		return false;
+	}
+
+	write_chunk(to, "IEND", {});
+	if (!to) {
+		LOG_ERROR("Error writing png.");
+		return false;
+	}
+	return true;
+}
+
+bool save_png_parallel(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, unsigned int threads, int level) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		LOG_ERROR("  cannot open file.");
+		return false;
+	}
+	return save_png_parallel(file, width, height, data, origin, threads, level);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "load_save_png.hpp"
+
+#include <string>
+#include <stdint.h>
+
+/*
+ * Multithreaded PNG encoder.
+ * The image is cut into horizontal strips that are filtered and deflated on separate threads
+ * (each primed with the previous strip's last 32k as a dictionary and ended with a sync flush,
+ * as pigz does) and then stitched into a single zlib stream, so the output is an ordinary PNG.
+ * Writes 8-bit RGBA, as save_png does.
+ */
+
+//threads == 0 uses one thread per hardware thread; level is a zlib compression level (0-9):
+bool save_png_parallel(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, unsigned int threads = 0, int level = 6);
+bool save_png_parallel(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin = UpperLeftOrigin, unsigned int threads = 0, int level = 6);
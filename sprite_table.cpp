@@ -0,0 +1,103 @@
+#include "sprite_table.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+Sprite const *SpriteTable::find(std::string const &name) const {
+	auto f = sprites.find(name);
+	if (f == sprites.end()) return nullptr;
+	return &f->second;
+}
+
+//'filename' is only for messages:
+static bool read_sprite_table(std::istream &file, std::string const &filename, SpriteTable *table) {
+	bool have_atlas = false;
+	std::string line;
+	for (unsigned int line_number = 1; std::getline(file, line); ++line_number) {
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream in(line);
+		std::string name;
+		in >> name;
+		if (name == "atlas") {
+			if (!(in >> table->width >> table->height >> table->align) || table->align == 0) {
+				LOG_ERROR("Sprite table '" << filename << "' has a bad atlas line (line " << line_number << ").");
+				return false;
+			}
+			have_atlas = true;
+			continue;
+		}
+		Sprite sprite;
+		if (!(in >> sprite.x >> sprite.y >> sprite.w >> sprite.h >> sprite.trim_x >> sprite.trim_y >> sprite.source_width >> sprite.source_height)) {
+			LOG_ERROR("Sprite table '" << filename << "' has a bad entry for '" << name << "' (line " << line_number << ").");
+			return false;
+		}
+		if (!have_atlas || sprite.x + sprite.w > table->width || sprite.y + sprite.h > table->height
+		 || sprite.trim_x + sprite.w > sprite.source_width || sprite.trim_y + sprite.h > sprite.source_height) {
+			LOG_ERROR("Sprite '" << name << "' in sprite table '" << filename << "' lies outside its atlas or source (line " << line_number << ").");
+			return false;
+		}
+		if (!table->sprites.emplace(name, sprite).second) {
+			LOG_ERROR("Sprite table '" << filename << "' lists '" << name << "' twice (line " << line_number << ").");
+			return false;
+		}
+	}
+	if (!have_atlas) {
+		LOG_ERROR("Sprite table '" << filename << "' has no atlas line.");
+		return false;
+	}
+	return true;
+}
+
+bool load_sprite_table(std::string const &filename, SpriteTable *table) {
+	assert(table);
+	*table = SpriteTable();
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		LOG_ERROR("Failed to open sprite table '" << filename << "'.");
+		return false;
+	}
+	return read_sprite_table(file, filename, table);
+}
+
+bool load_sprite_table(uint8_t const *bytes, size_t size, SpriteTable *table) {
+	assert(table);
+	*table = SpriteTable();
+
+	std::istringstream in(std::string(reinterpret_cast< char const * >(bytes), size));
+	return read_sprite_table(in, "(in memory)", table);
+}
+
+bool save_sprite_table(std::string const &filename, SpriteTable const &table) {
+	//sorted by name, so the file only changes when the packing does:
+	std::vector< std::string > names;
+	names.reserve(table.sprites.size());
+	for (auto const &s : table.sprites) {
+		names.emplace_back(s.first);
+	}
+	std::sort(names.begin(), names.end());
+
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	file << "#sprite table written by pack_atlas; rects are in texels, upper-left origin\n";
+	file << "atlas " << table.width << ' ' << table.height << ' ' << table.align << '\n';
+	file << "#name x y w h trim_x trim_y source_width source_height\n";
+	for (auto const &name : names) {
+		Sprite const &s = table.sprites.at(name);
+		file << name << ' ' << s.x << ' ' << s.y << ' ' << s.w << ' ' << s.h
+		     << ' ' << s.trim_x << ' ' << s.trim_y << ' ' << s.source_width << ' ' << s.source_height << '\n';
+	}
+	if (!file) {
+		LOG_ERROR("Failed to write sprite table '" << filename << "'.");
+		file.close();
+		std::remove(filename.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Where each named sprite lives in the atlas, as written by pack_atlas next to the atlas it packs.
+ * The table is a text file:
+ *   atlas <width> <height> <align>
+ *   <name> <x> <y> <w> <h> <trim x> <trim y> <source width> <source height>
+ *   ...
+ * with all rects in texels, upper-left origin (as in the atlas PNG); '#' starts a comment line.
+ */
+
+struct Sprite {
+	//texels of the atlas holding the (trimmed) sprite:
+	unsigned int x = 0, y = 0, w = 0, h = 0;
+	//where those texels sat in the untrimmed source, and the source's size:
+	unsigned int trim_x = 0, trim_y = 0;
+	unsigned int source_width = 0, source_height = 0;
+};
+
+struct SpriteTable {
+	unsigned int width = 0; //atlas size
+	unsigned int height = 0;
+	//each sprite sits alone in a slot of whole align x align cells (its rect, inset by any padding and
+	// trimmed, needn't start or end on a multiple of this), so a mip chain built with this cell size
+	// never mixes texels of two sprites:
+	unsigned int align = 1;
+	std::unordered_map< std::string, Sprite > sprites;
+
+	//nullptr if there's no such sprite:
+	Sprite const *find(std::string const &name) const;
+};
+
+bool load_sprite_table(std::string const &filename, SpriteTable *table);
+//from a whole sprite table file already in memory:
+bool load_sprite_table(uint8_t const *bytes, size_t size, SpriteTable *table);
+bool save_sprite_table(std::string const &filename, SpriteTable const &table);
@@ -0,0 +1,113 @@
+#include "stream_buffer.hpp"
+
+#include <iostream>
+#include <cassert>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+StreamBuffer::~StreamBuffer() {
+	destroy();
+}
+
+bool StreamBuffer::create(GLenum target_, size_t region_size_, unsigned int regions_, PFNGLBUFFERSTORAGEPROC buffer_storage) {
+	destroy();
+	assert(region_size_ > 0 && regions_ > 0);
+	target = target_;
+	region_size = region_size_;
+	regions = regions_;
+	current = 0;
+	used = 0;
+	fences.assign(regions, 0);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	GLsizeiptr size = GLsizeiptr(region_size) * regions;
+	if (buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		buffer_storage(target, size, nullptr, flags);
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(target, 0, size, flags));
+		if (mapped) {
+			persistent = true;
+			return true;
+		}
+		//(immutable storage can't be respecified, so start over with a fresh buffer)
+		LOG_ERROR("NOTE: couldn't map stream buffer persistently; mapping it per allocation instead.");
+		glDeleteBuffers(1, &buffer);
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+	}
+	glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+	persistent = false;
+	return true;
+}
+
+void StreamBuffer::destroy() {
+	if (buffer && mapped) {
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+	}
+	mapped = nullptr;
+	for (auto &fence : fences) {
+		if (fence) glDeleteSync(fence);
+	}
+	fences.clear();
+	if (buffer) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	persistent = false;
+}
+
+void StreamBuffer::begin_frame() {
+	assert(buffer);
+	used = 0;
+	GLsync &fence = fences[current];
+	if (!fence) return;
+	//(usually long signaled, since 'regions - 1' other frames have gone by since)
+	while (true) {
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+		if (result != GL_TIMEOUT_EXPIRED) {
+			if (result == GL_WAIT_FAILED) LOG_ERROR("Waiting on a stream buffer fence failed.");
+			break;
+		}
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
+
+void *StreamBuffer::allocate(size_t size, size_t alignment, size_t *offset) {
+	assert(buffer);
+	assert(alignment > 0);
+	assert(offset);
+	size_t region_start = size_t(current) * region_size;
+	size_t at = (region_start + used + alignment - 1) / alignment * alignment;
+	if (at + size > region_start + region_size) return nullptr;
+	used = at + size - region_start;
+	*offset = at;
+	if (persistent) return mapped + at;
+
+	flush();
+	glBindBuffer(target, buffer);
+	mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(target, at, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+	if (!mapped) {
+		LOG_ERROR("Failed to map " << size << " bytes of stream buffer.");
+	}
+	return mapped;
+}
+
+void StreamBuffer::flush() {
+	//(a coherent persistent mapping needs nothing more)
+	if (persistent || !mapped) return;
+	glBindBuffer(target, buffer);
+	glUnmapBuffer(target);
+	mapped = nullptr;
+}
+
+void StreamBuffer::end_frame() {
+	assert(buffer);
+	flush();
+	assert(!fences[current]);
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current = (current + 1) % regions;
+	used = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Ring of per-frame regions in one buffer object, for data written fresh every frame (e.g. sprite vertices).
+ * Each frame writes into its own region and fences it once the draws reading it are issued; a region is
+ * only written again after its fence signals (i.e., 'regions' frames later, typically without waiting).
+ * With GL_ARB_buffer_storage the buffer is mapped once, persistently and coherently, so allocate() just hands
+ * out pointers into it; on plain GL 3.3 each allocation is mapped with GL_MAP_UNSYNCHRONIZED_BIT (safe,
+ * since the fences already do the syncing) and unmapped by flush(). Either way, data is written straight
+ * into memory the GPU reads from: no per-frame allocation, no glBufferData copy, no orphaning.
+ *
+ * All members must be called on the thread that owns the GL context (which must still be current
+ * when the StreamBuffer is destroyed).
+ */
+
+struct StreamBuffer {
+	StreamBuffer() = default;
+	~StreamBuffer();
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+	//make a buffer of 'regions' regions of 'region_size' bytes, to be bound to 'target'; pass glBufferStorage
+	// (if the context has GL_ARB_buffer_storage) to map it persistently, or nullptr to map per allocation:
+	bool create(GLenum target, size_t region_size, unsigned int regions, PFNGLBUFFERSTORAGEPROC buffer_storage);
+	void destroy();
+
+	//start writing the next region (waiting for the GPU to finish with it, if it hasn't yet):
+	void begin_frame();
+
+	//'size' bytes of this frame's region, starting at a multiple of 'alignment' bytes from the start of the
+	// buffer (stored in 'offset', for the draw call); nullptr if the region hasn't got room. The pointer is
+	// write-only, and good until the next allocate() or flush():
+	void *allocate(size_t size, size_t alignment, size_t *offset);
+
+	//done writing (for now) -- call before drawing from what was allocated:
+	void flush();
+
+	//fence this frame's region, after the draws that read it:
+	void end_frame();
+
+	GLuint buffer = 0;
+	bool persistent = false;
+
+private:
+	GLenum target = GL_ARRAY_BUFFER;
+	size_t region_size = 0;
+	unsigned int regions = 0;
+	unsigned int current = 0; //region being written
+	size_t used = 0; //bytes of it allocated so far
+	uint8_t *mapped = nullptr; //whole buffer (persistent), or the last allocation (per-allocation mapping)
+	std::vector< GLsync > fences; //per region; 0 if it isn't in flight
+};
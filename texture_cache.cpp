@@ -0,0 +1,123 @@
+#include "texture_cache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+static const char CACHE_MAGIC[8] = {'p','x','c','a','c','h','e','\0'};
+static const uint32_t CACHE_VERSION = 3;
+//pixels start one page in, so they are page-aligned in the mapping:
+static const size_t CACHE_HEADER_SIZE = 4096;
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t origin;
+	uint32_t alpha;
+	uint64_t source_size;
+	uint64_t source_hash;
+};
+static_assert(sizeof(CacheHeader) <= CACHE_HEADER_SIZE, "Cache header fits in its page.");
+
+static bool write_cache(std::string const &cache_filename, CacheHeader const &header, uint8_t const *pixels) {
+	//write next to the real cache and rename into place, so a partial write is never mistaken for a cache:
+	std::string temp_filename = cache_filename + ".tmp";
+	{
+		std::ofstream file(temp_filename.c_str(), std::ios::binary);
+		std::vector< char > page(CACHE_HEADER_SIZE, 0);
+		memcpy(&page[0], &header, sizeof(header));
+		file.write(&page[0], page.size());
+		file.write(reinterpret_cast< char const * >(pixels), size_t(header.width) * header.height * header.channels);
+		if (!file) {
+			file.close();
+			std::remove(temp_filename.c_str());
+			return false;
+		}
+	}
+	#ifdef _WIN32
+	//rename() won't replace an existing file on windows:
+	std::remove(cache_filename.c_str());
+	#endif
+	if (std::rename(temp_filename.c_str(), cache_filename.c_str()) != 0) {
+		std::remove(temp_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool load_png_cached(std::string const &filename, std::string const &cache_filename, CachedImage *image, OriginLocation origin, AlphaMode alpha) {
+	assert(image);
+	image->width = image->height = image->channels = 0;
+	image->data = nullptr;
+	image->file.close();
+	image->storage.reset();
+
+	MappedFile source;
+	if (!source.open(filename)) {
+		return false;
+	}
+	uint64_t source_hash = hash_bytes(source.data, source.size);
+
+	{ //serve from the cache if it matches the source:
+		MappedFile cache;
+		if (cache.open(cache_filename, true) && cache.size >= CACHE_HEADER_SIZE) {
+			CacheHeader header;
+			memcpy(&header, cache.data, sizeof(header));
+			if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+			 && header.version == CACHE_VERSION
+			 && header.origin == uint32_t(origin)
+			 && header.alpha == uint32_t(alpha)
+			 && header.source_size == source.size
+			 && header.source_hash == source_hash
+			 && (header.channels == 1 || header.channels == 2 || header.channels == 4)
+			 && cache.size == CACHE_HEADER_SIZE + size_t(header.width) * header.height * header.channels) {
+				image->width = header.width;
+				image->height = header.height;
+				image->channels = header.channels;
+				image->file = std::move(cache);
+				image->data = image->file.data + CACHE_HEADER_SIZE;
+				return true;
+			}
+		}
+	}
+
+	//cache is missing or stale, so decode (from the mapping we already have) and rebuild it:
+	unsigned int w, h, c;
+	if (!load_png_info(source.data, source.size, &w, &h, &c)) {
+		return false;
+	}
+	image->storage.reset(new uint8_t[size_t(w) * h * c]);
+	if (!load_png_channels(source.data, source.size, w, h, c, image->storage.get(), size_t(w) * c, origin, alpha)) {
+		image->storage.reset();
+		return false;
+	}
+	image->width = w;
+	image->height = h;
+	image->channels = c;
+	image->data = image->storage.get();
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.width = w;
+	header.height = h;
+	header.channels = c;
+	header.origin = uint32_t(origin);
+	header.alpha = uint32_t(alpha);
+	header.source_size = source.size;
+	header.source_hash = source_hash;
+	if (!write_cache(cache_filename, header, image->data)) {
+		//not fatal -- the pixels are already decoded, we just pay for it again next time:
+		LOG_ERROR("NOTE: couldn't write texture cache '" << cache_filename << "'.");
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "load_save_png.hpp"
+#include "mapped_file.hpp"
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+/*
+ * Disk cache of decoded PNG pixels.
+ * A cache file is a page-sized header (dimensions, origin, alpha mode, hash of the source file) followed by
+ * raw pixels (as load_png_channels returns them), so a valid cache is served straight out of an mmap without touching libpng.
+ * The cache is rebuilt whenever the source file's contents no longer match the stored hash.
+ */
+
+struct CachedImage {
+	unsigned int width = 0;
+	unsigned int height = 0;
+	//bytes per pixel: 1 (gray), 2 (gray+alpha) or 4 (RGBA):
+	unsigned int channels = 0;
+	//width*height*channels bytes, rows tightly packed; valid as long as this CachedImage is:
+	uint8_t const *data = nullptr;
+
+	//backing storage -- the cache mapping, or decoded pixels if the cache couldn't be used:
+	MappedFile file;
+	std::unique_ptr< uint8_t[] > storage;
+};
+
+bool load_png_cached(std::string const &filename, std::string const &cache_filename, CachedImage *image, OriginLocation origin, AlphaMode alpha = StraightAlpha);
@@ -0,0 +1,218 @@
+#include "texture_reload.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+//how often to look at the file where there's no inotify:
+static const std::chrono::milliseconds POLL_INTERVAL(250);
+
+TextureReload::~TextureReload() {
+	stop();
+}
+
+void TextureReload::stop() {
+	if (worker.joinable()) worker.join();
+	#ifdef __linux__
+	if (inotify_fd != -1) {
+		::close(inotify_fd);
+		inotify_fd = -1;
+	}
+	#endif
+	filename.clear();
+	texture = 0;
+	resident.clear();
+	incoming.clear();
+	tiles.clear();
+	pending = false;
+	finished = 0;
+}
+
+#ifndef __linux__
+static int64_t file_stamp(std::string const &filename) {
+	#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(filename.c_str(), &st) != 0) return 0;
+	#else
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) return 0;
+	#endif
+	//(mtime alone has one-second resolution on some systems, so fold in the size too)
+	return int64_t(st.st_mtime) * 1000003 + int64_t(st.st_size);
+}
+#endif
+
+bool TextureReload::watch(std::string const &filename_, GLuint texture_, unsigned int width_, unsigned int height_, unsigned int levels_,
+	uint32_t const *pixels, OriginLocation origin_, AlphaMode alpha_) {
+	stop();
+	assert(levels_ >= 1);
+	filename = filename_;
+	texture = texture_;
+	width = width_;
+	height = height_;
+	levels = levels_;
+	origin = origin_;
+	alpha = alpha_;
+	resident.assign(pixels, pixels + size_t(width) * height);
+	tile_size = std::max(32U, 1U << (levels - 1));
+
+	#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1) {
+		LOG_ERROR("Failed to start inotify (" << strerror(errno) << ").");
+		stop();
+		return false;
+	}
+	//editors (and build tools) often replace a file rather than rewrite it, so watch its directory for the name:
+	size_t slash = filename.find_last_of('/');
+	std::string directory = (slash == std::string::npos ? "." : filename.substr(0, slash + 1));
+	if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+		LOG_ERROR("Failed to watch '" << directory << "' (" << strerror(errno) << ").");
+		stop();
+		return false;
+	}
+	#else
+	stamp = file_stamp(filename);
+	next_poll = std::chrono::steady_clock::now() + POLL_INTERVAL;
+	#endif
+	return true;
+}
+
+bool TextureReload::changed() {
+	#ifdef __linux__
+	size_t slash = filename.find_last_of('/');
+	std::string name = (slash == std::string::npos ? filename : filename.substr(slash + 1));
+	bool seen = false;
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t got = read(inotify_fd, buffer, sizeof(buffer));
+		if (got <= 0) break; //(EAGAIN: no more events)
+		for (char const *at = buffer; at < buffer + got; ) {
+			inotify_event const *event = reinterpret_cast< inotify_event const * >(at);
+			if (event->len > 0 && name == event->name) seen = true;
+			at += sizeof(inotify_event) + event->len;
+		}
+	}
+	return seen;
+	#else
+	auto now = std::chrono::steady_clock::now();
+	if (now < next_poll) return false;
+	next_poll = now + POLL_INTERVAL;
+	int64_t current = file_stamp(filename);
+	if (current == stamp) return false;
+	stamp = current;
+	return true;
+	#endif
+}
+
+bool TextureReload::reload() {
+	unsigned int w = 0, h = 0;
+	if (!load_png(filename, &w, &h, &incoming, origin, alpha)) {
+		//(possibly caught mid-write; the next change will try again)
+		LOG_ERROR("Failed to reload '" << filename << "'.");
+		return false;
+	}
+	if (w != width || h != height) {
+		LOG_ERROR("'" << filename << "' is now " << w << "x" << h << " (was " << width << "x" << height << "); restart to pick it up.");
+		return false;
+	}
+
+	for (unsigned int ty = 0; ty < height; ty += tile_size) {
+		for (unsigned int tx = 0; tx < width; tx += tile_size) {
+			unsigned int tw = std::min(tile_size, width - tx);
+			unsigned int th = std::min(tile_size, height - ty);
+			bool same = true;
+			for (unsigned int y = ty; y < ty + th && same; ++y) {
+				size_t row = size_t(y) * width + tx;
+				same = (memcmp(&incoming[row], &resident[row], tw * sizeof(uint32_t)) == 0);
+			}
+			if (same) continue;
+
+			tiles.emplace_back();
+			Tile &tile = tiles.back();
+			tile.x = tx;
+			tile.y = ty;
+			tile.w = tw;
+			tile.h = th;
+			//box-filter the tile's own texels down the chain:
+			std::vector< uint32_t > above(size_t(tw) * th);
+			for (unsigned int y = 0; y < th; ++y) {
+				memcpy(&above[size_t(y) * tw], &incoming[size_t(ty + y) * width + tx], tw * sizeof(uint32_t));
+			}
+			unsigned int aw = tw, ah = th;
+			for (unsigned int l = 1; l < levels; ++l) {
+				unsigned int lw = aw / 2, lh = ah / 2;
+				std::vector< uint32_t > level(size_t(lw) * lh);
+				uint8_t const *from = reinterpret_cast< uint8_t const * >(above.data());
+				uint8_t *to = reinterpret_cast< uint8_t * >(level.data());
+				for (unsigned int y = 0; y < lh; ++y) {
+					for (unsigned int x = 0; x < lw; ++x) {
+						uint8_t const *p00 = from + (size_t(2 * y) * aw + 2 * x) * 4;
+						uint8_t const *p10 = p00 + 4;
+						uint8_t const *p01 = p00 + size_t(aw) * 4;
+						uint8_t const *p11 = p01 + 4;
+						for (unsigned int c = 0; c < 4; ++c) {
+							to[(size_t(y) * lw + x) * 4 + c] = uint8_t((p00[c] + p10[c] + p01[c] + p11[c] + 2) / 4);
+						}
+					}
+				}
+				tile.levels.emplace_back(level);
+				above.swap(level);
+				aw = lw;
+				ah = lh;
+			}
+		}
+	}
+	return true;
+}
+
+unsigned int TextureReload::update() {
+	if (filename.empty()) return 0;
+	if (changed()) pending = true;
+
+	unsigned int uploaded = 0;
+	if (worker.joinable()) {
+		int result = finished.load();
+		if (result == 0) return 0;
+		worker.join();
+		finished = 0;
+		if (result > 0 && !tiles.empty()) {
+			glBindTexture(GL_TEXTURE_2D, texture);
+			//level 0 goes straight from the decoded image:
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+			for (auto const &tile : tiles) {
+				glTexSubImage2D(GL_TEXTURE_2D, 0, tile.x, tile.y, tile.w, tile.h, GL_RGBA, GL_UNSIGNED_BYTE, &incoming[size_t(tile.y) * width + tile.x]);
+			}
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			for (auto const &tile : tiles) {
+				for (unsigned int l = 1; l < levels; ++l) {
+					unsigned int lw = tile.w >> l, lh = tile.h >> l;
+					if (lw == 0 || lh == 0) break;
+					glTexSubImage2D(GL_TEXTURE_2D, l, tile.x >> l, tile.y >> l, lw, lh, GL_RGBA, GL_UNSIGNED_BYTE, tile.levels[l - 1].data());
+				}
+			}
+			uploaded = unsigned(tiles.size());
+			resident.swap(incoming);
+		}
+		incoming.clear();
+		tiles.clear();
+	}
+	if (pending && !worker.joinable()) {
+		pending = false;
+		worker = std::thread([this]() {
+			finished = (reload() ? 1 : -1);
+		});
+	}
+	return uploaded;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "load_save_png.hpp"
+#include "GL.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Hot reload of an RGBA8 texture from the PNG it was made from.
+ * watch() keeps a copy of the texture's level 0 and watches the PNG (inotify on Linux; elsewhere,
+ * its modification time, polled a few times a second). When the PNG changes, a worker decodes it,
+ * diffs it against the resident copy in square tiles, and box-filters the mip levels of just the
+ * tiles that changed; update() (on the GL thread) then re-uploads those rectangles with
+ * glTexSubImage2D -- so touching up one sprite costs a few small uploads, not a whole-atlas
+ * glTexImage2D in the middle of a frame.
+ *
+ * The PNG must keep the texture's size (a change of size is reported and ignored), and the texture
+ * must be uncompressed. Mip levels rebuilt here are a plain box filter of premultiplied texels, not
+ * the gamma-correct, coverage-preserving chain build_mips makes; rebuild the .mips for that.
+ *
+ * All members must be called on the thread that owns the GL context.
+ */
+
+struct TextureReload {
+	TextureReload() = default;
+	~TextureReload();
+	TextureReload(TextureReload const &) = delete;
+	TextureReload &operator=(TextureReload const &) = delete;
+
+	//start watching 'filename' for changes to 'texture', whose levels 0..levels-1 were uploaded from
+	// the PNG (level 0 being 'pixels', width x height) decoded with 'origin' and 'alpha':
+	bool watch(std::string const &filename, GLuint texture, unsigned int width, unsigned int height, unsigned int levels,
+		uint32_t const *pixels, OriginLocation origin, AlphaMode alpha);
+
+	//check for changes and apply any finished reload; returns the number of tiles re-uploaded:
+	unsigned int update();
+
+	//stop watching (waiting for the worker, if it's running):
+	void stop();
+
+	//tile edge, in level 0 texels (a multiple of 1 << (levels - 1), so tiles stay whole at every level):
+	unsigned int tile_size = 0;
+
+private:
+	bool changed(); //has the file changed since last asked?
+	bool reload(); //(on the worker) decode the file and find changed tiles
+
+	std::string filename;
+	GLuint texture = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int levels = 0;
+	OriginLocation origin = LowerLeftOrigin;
+	AlphaMode alpha = StraightAlpha;
+	std::vector< uint32_t > resident; //level 0, as uploaded
+
+	//watching:
+	#ifdef __linux__
+	int inotify_fd = -1;
+	#else
+	int64_t stamp = 0; //modification time and size
+	std::chrono::steady_clock::time_point next_poll;
+	#endif
+
+	//reloading (the worker fills these in, then sets 'finished'):
+	struct Tile {
+		unsigned int x, y, w, h; //level 0 texels
+		std::vector< std::vector< uint32_t > > levels; //levels 1 and up, tightly packed
+	};
+	std::thread worker;
+	std::atomic< int > finished{0}; //+1 decoded, -1 failed
+	bool pending = false; //the file changed while the worker was busy
+	std::vector< uint32_t > incoming; //new level 0
+	std::vector< Tile > tiles; //tiles of 'incoming' that differ from 'resident'
+};
@@ -0,0 +1,135 @@
+#include "texture_upload.hpp"
+
+#include <iostream>
+#include <cassert>
+
+#define LOG_ERROR( X ) std::cerr << X << std::endl
+
+TextureUpload::~TextureUpload() {
+	release();
+}
+
+void TextureUpload::cancel() {
+	release();
+	if (state == Decoding || state == Transferring) state = Idle;
+}
+
+void TextureUpload::release() {
+	//the worker may still be writing into the mapping, so it has to finish before the buffer goes away:
+	if (worker.joinable()) worker.join();
+	if (buffer) {
+		if (state == Decoding) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	if (fence) {
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	file.close();
+}
+
+bool TextureUpload::start(std::string const &filename, GLuint texture_, OriginLocation origin, AlphaMode alpha) {
+	release();
+	state = Failed;
+	texture = texture_;
+	decoded = 0;
+
+	//the header is tiny, so read it here to size the buffer; the rest of the file is decoded by the worker:
+	if (!file.open(filename)) {
+		return false;
+	}
+	if (!load_png_info(file.data, file.size, &width, &height, &channels)) {
+		LOG_ERROR("Failed to read header of '" << filename << "'.");
+		file.close();
+		return false;
+	}
+	size_t size = size_t(width) * height * channels;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	uint8_t *pixels = reinterpret_cast< uint8_t * >(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	//(left unbound so other uploads in the meantime read from client memory as usual)
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!pixels) {
+		LOG_ERROR("Failed to map pixel unpack buffer for '" << filename << "'.");
+		release();
+		return false;
+	}
+
+	state = Decoding;
+	unsigned int w = width, h = height, c = channels;
+	uint8_t const *bytes = file.data;
+	size_t bytes_size = file.size;
+	worker = std::thread([this, bytes, bytes_size, w, h, c, pixels, origin, alpha]() {
+		bool ok = load_png_channels(bytes, bytes_size, w, h, c, pixels, size_t(w) * c, origin, alpha);
+		decoded = (ok ? 1 : -1);
+	});
+	return true;
+}
+
+bool TextureUpload::update() {
+	if (state == Decoding) {
+		int result = decoded.load();
+		if (result == 0) return false;
+		worker.join();
+		file.close();
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		//(unmap can fail if the mapping was lost, e.g. on a mode switch, in which case the contents are undefined)
+		bool unmapped = (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+		if (result > 0 && unmapped) {
+			glBindTexture(GL_TEXTURE_2D, texture);
+			//with an unpack buffer bound, the data pointer is an offset into it:
+			tex_image_2d(width, height, channels, 0);
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			state = Transferring;
+		} else {
+			state = Failed;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (state == Failed) {
+			LOG_ERROR("Failed to " << (result > 0 ? "unmap" : "decode into") << " pixel unpack buffer.");
+			release();
+			return false;
+		}
+		//make sure the commands get to the GPU, so the fence will eventually signal without anyone waiting on it:
+		glFlush();
+	}
+	if (state == Transferring) {
+		//timeout 0 just polls:
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) return false;
+		if (status == GL_WAIT_FAILED) {
+			LOG_ERROR("Waiting on texture upload fence failed.");
+		}
+		release();
+		state = Done;
+	}
+	return state == Done;
+}
+
+void tex_image_2d(unsigned int width, unsigned int height, unsigned int channels, void const *pixels) {
+	if (channels == 1 || channels == 2) {
+		//rows of one- or two-byte texels needn't be 4-byte aligned:
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (channels == 1) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+			GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, pixels);
+			GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	} else {
+		assert(channels == 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+}
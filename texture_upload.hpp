@@ -0,0 +1,67 @@
+#pragma once
+
+#include "load_save_png.hpp"
+#include "mapped_file.hpp"
+#include "GL.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/*
+ * Asynchronous PNG-to-texture upload through a pixel unpack buffer.
+ * start() maps a GL_PIXEL_UNPACK_BUFFER and hands the mapping to a worker thread, which decodes
+ * straight into it; update() (called on the GL thread, e.g. once a frame) unmaps the buffer and
+ * issues glTexImage2D from it once the decode is done, then polls a fence to learn when the driver
+ * has finished reading the buffer so it can be freed.
+ * Pixels are decoded exactly once, into memory the driver can copy from directly, and nothing on
+ * the GL thread waits for either the decode or the transfer.
+ *
+ * All members must be called on the thread that owns the GL context (which must still be current
+ * when the TextureUpload is destroyed).
+ */
+
+struct TextureUpload {
+	TextureUpload() = default;
+	~TextureUpload();
+	TextureUpload(TextureUpload const &) = delete;
+	TextureUpload &operator=(TextureUpload const &) = delete;
+
+	//begin loading 'filename' into (the level 0 storage of) 'texture'; returns false if the upload
+	// couldn't even be started (missing file, bad header, ...):
+	bool start(std::string const &filename, GLuint texture, OriginLocation origin, AlphaMode alpha = StraightAlpha);
+
+	//advance the upload; returns true once the texture holds the image (and on every call after that):
+	bool update();
+
+	//abandon an upload in progress (waiting for the worker, if needed) and free its buffer:
+	void cancel();
+
+	enum State {
+		Idle,
+		Decoding, //worker is writing into the mapped buffer
+		Transferring, //glTexImage2D issued, fence not yet signaled
+		Done,
+		Failed,
+	} state = Idle;
+
+	GLuint texture = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int channels = 0;
+
+private:
+	void release();
+
+	MappedFile file;
+	GLuint buffer = 0;
+	GLsync fence = 0;
+	std::thread worker;
+	//set by the worker when it is done: +1 decoded, -1 failed:
+	std::atomic< int > decoded{0};
+};
+
+//glTexImage2D level 0 of the bound GL_TEXTURE_2D from 'pixels' (or, with a bound unpack buffer, an offset into it):
+// 1- and 2-channel data stays one and two bytes per texel (GL_R8 / GL_RG8), swizzled to sample as
+// (g,g,g,1) and (g,g,g,a) just like the RGBA version would:
+void tex_image_2d(unsigned int width, unsigned int height, unsigned int channels, void const *pixels);